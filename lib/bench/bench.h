@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <glm/glm.hpp>
+
+/** Wall time of f in milliseconds, averaged over repeats calls */
+template <typename F>
+double timeMs(F f, int repeats = 1) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+/** Fastest of runs calls of f, in milliseconds */
+template <typename F>
+double bestTimeMs(F f, int runs) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        double ms = timeMs(f);
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+/** Uniform in [lo, hi], from rand() so srand() makes runs repeatable */
+inline float frand(float lo, float hi) {
+    return lo + (hi - lo) * rand() / (float)RAND_MAX;
+}
+
+inline glm::vec3 vrand(float lo, float hi) {
+    return glm::vec3(frand(lo, hi), frand(lo, hi), frand(lo, hi));
+}
@@ -0,0 +1,95 @@
+/**
+ * Polygon booleans on 10k vertex concave inputs.
+ * The sweep crossing search is compared against testing every edge pair, also
+ * on sawtooth inputs where every edge spans the whole width (all edges active
+ * at once).
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../boolean.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define NUM_VERTICES 10000
+
+// Star shaped and concave: wavy outline with some noise
+static vector<vec2> randomStar(int n, vec2 center, float phase) {
+    vector<vec2> poly;
+    for (int i = 0; i < n; i++) {
+        float angle = 6.2831853f * i / n;
+        float radius = 0.75f + 0.15f * sin(5.0f * angle + phase) + 0.08f * sin(37.0f * angle) + 0.01f * rand() / (float)RAND_MAX;
+        poly.push_back(center + radius * vec2(cos(angle), sin(angle)));
+    }
+    return poly;
+}
+
+// Edges zig zag between x = 0 and x = 1 going up, closed on the side given by x_close.
+// The clipper is offset by half a tooth so each edge crosses its two neighbors
+static vector<vec2> sawtooth(int n, float offset, float x_close) {
+    vector<vec2> poly;
+    float step = 1.0f / n;
+    for (int i = 0; i < n; i++) {
+        poly.push_back(vec2((i + (offset > 0.0f)) % 2 ? 1.0f : 0.0f, (i + offset) * step));
+    }
+    poly.push_back(vec2(x_close, 1.0f + step));
+    poly.push_back(vec2(x_close, -step));
+    return poly;
+}
+
+static size_t bruteForceCrossings(const vector<vec2>& a, const vector<vec2>& b) {
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        vec2 p0 = a[i], p1 = a[(i + 1) % a.size()];
+        for (size_t j = 0; j < b.size(); j++) {
+            vec2 q0 = b[j], q1 = b[(j + 1) % b.size()];
+            double d1 = (double)(q1.x - q0.x) * (p0.y - q0.y) - (double)(q1.y - q0.y) * (p0.x - q0.x);
+            double d2 = (double)(q1.x - q0.x) * (p1.y - q0.y) - (double)(q1.y - q0.y) * (p1.x - q0.x);
+            double d3 = (double)(p1.x - p0.x) * (q0.y - p0.y) - (double)(p1.y - p0.y) * (q0.x - p0.x);
+            double d4 = (double)(p1.x - p0.x) * (q1.y - p0.y) - (double)(p1.y - p0.y) * (q1.x - p0.x);
+            if ((d1 > 0) != (d2 > 0) && (d3 > 0) != (d4 > 0)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+int main() {
+    srand(1);
+    vector<vec2> subject = randomStar(NUM_VERTICES, vec2(0.0f, 0.0f), 0.0f);
+    vector<vec2> clipper = randomStar(NUM_VERTICES, vec2(0.3f, 0.1f), 1.0f);
+
+    size_t sweep_count = 0, brute_count = 0;
+    double sweep_ms = timeMs([&] { sweep_count = countCrossings(subject, clipper); });
+    double brute_ms = timeMs([&] { brute_count = bruteForceCrossings(subject, clipper); });
+    printf("%d + %d vertices, crossing search\n", NUM_VERTICES, NUM_VERTICES);
+    printf("  sweep:       %8.2f ms (%zu crossings)\n", sweep_ms, sweep_count);
+    printf("  all pairs:   %8.2f ms (%zu crossings)\n", brute_ms, brute_count);
+
+    const char* names[] = { "intersection", "union", "difference" };
+    for (int op = 0; op < 3; op++) {
+        vector<vector<vec2>> result;
+        double ms = timeMs([&] { result = polygonBoolean(subject, clipper, (BooleanOp)op); });
+        printf("  %-12s %8.2f ms (%zu pieces)\n", names[op], ms, result.size());
+    }
+
+    subject = sawtooth(NUM_VERTICES, 0.0f, -0.5f);
+    clipper = sawtooth(NUM_VERTICES, 0.5f, 1.5f);
+    sweep_ms = timeMs([&] { sweep_count = countCrossings(subject, clipper); });
+    brute_ms = timeMs([&] { brute_count = bruteForceCrossings(subject, clipper); });
+    printf("%d + %d vertices, sawtooth (edges spanning the whole width)\n", NUM_VERTICES, NUM_VERTICES);
+    printf("  sweep:       %8.2f ms (%zu crossings)\n", sweep_ms, sweep_count);
+    printf("  all pairs:   %8.2f ms (%zu crossings)\n", brute_ms, brute_count);
+    for (int op = 0; op < 3; op++) {
+        vector<vector<vec2>> result;
+        double ms = timeMs([&] { result = polygonBoolean(subject, clipper, (BooleanOp)op); });
+        printf("  %-12s %8.2f ms (%zu pieces)\n", names[op], ms, result.size());
+    }
+    return 0;
+}
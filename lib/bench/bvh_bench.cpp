@@ -0,0 +1,194 @@
+/**
+ * BVH build and ray queries on joint_bone.obj (or the .obj given as argument).
+ * Closest-hit camera rays and any-hit shadow rays are traced on every core,
+ * a subset of them is checked against testing every triangle.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../bvh.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define IMAGE_SIZE 1024
+#define NUM_CHECKED_RAYS 2000
+
+// Positions and faces only, polygons as fans
+static bool loadObj(const string& filename, vector<vec3>* positions, vector<unsigned int>* indices) {
+    ifstream file(filename);
+    if (!file) {
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        istringstream in(line);
+        string type;
+        in >> type;
+        if (type == "v") {
+            vec3 p;
+            in >> p.x >> p.y >> p.z;
+            positions->push_back(p);
+        } else if (type == "f") {
+            vector<unsigned int> face;
+            string vertex;
+            while (in >> vertex) {
+                face.push_back((unsigned int)stoul(vertex) - 1);
+            }
+            for (size_t k = 1; k + 1 < face.size(); k++) {
+                indices->insert(indices->end(), { face[0], face[k], face[k + 1] });
+            }
+        }
+    }
+    return true;
+}
+
+static bool bruteForce(const vector<vec3>& positions, const vector<unsigned int>& indices, const Ray& ray, float* t_hit) {
+    bool found = false;
+    *t_hit = ray.t_max;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        vec3 v0 = positions[indices[i]];
+        vec3 e1 = positions[indices[i + 1]] - v0, e2 = positions[indices[i + 2]] - v0;
+        vec3 p = cross(ray.direction, e2);
+        float det = dot(e1, p);
+        if (det == 0.0f) {
+            continue;
+        }
+        vec3 s = ray.origin - v0;
+        float u = dot(s, p) / det;
+        vec3 q = cross(s, e1);
+        float v = dot(ray.direction, q) / det;
+        float t = dot(e2, q) / det;
+        if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > ray.t_min && t < *t_hit) {
+            *t_hit = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Pinhole camera on the +z side of the bounding box, looking at its center
+static Ray cameraRay(vec3 lo, vec3 hi, int x, int y) {
+    vec3 center = (lo + hi) * 0.5f;
+    float radius = length(hi - lo) * 0.5f;
+    vec3 eye = center + vec3(0.3f, 0.2f, 1.0f) * (radius * 2.0f);
+    vec3 forward = normalize(center - eye);
+    vec3 right = normalize(cross(forward, vec3(0.0f, 1.0f, 0.0f)));
+    vec3 up = cross(right, forward);
+    float px = (x + 0.5f) / IMAGE_SIZE * 2.0f - 1.0f;
+    float py = 1.0f - (y + 0.5f) / IMAGE_SIZE * 2.0f;
+    return { eye, normalize(forward + (right * px + up * py) * 0.5f), 0.0f, INFINITY };
+}
+
+// Rows split between the threads, returns the number of hits
+template <typename F>
+static size_t traceRows(int num_threads, F trace_row) {
+    vector<future<size_t>> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.push_back(async(launch::async, [&, i]() {
+            size_t hits = 0;
+            for (int y = i; y < IMAGE_SIZE; y += num_threads) {
+                hits += trace_row(y);
+            }
+            return hits;
+        }));
+    }
+    size_t hits = 0;
+    for (future<size_t>& w : workers) {
+        hits += w.get();
+    }
+    return hits;
+}
+
+int main(int argc, char** argv) {
+    string filename = argc > 1 ? argv[1] : "../../project2/resources/objs/joint_bone.obj";
+    vector<vec3> positions;
+    vector<unsigned int> indices;
+    if (!loadObj(filename, &positions, &indices)) {
+        fprintf(stderr, "Failed to load %s\n", filename.c_str());
+        exit(-1);
+    }
+    int num_threads = std::max(1u, thread::hardware_concurrency());
+
+    vec3 lo(INFINITY), hi(-INFINITY);
+    for (unsigned int i : indices) {
+        lo = glm::min(lo, positions[i]);
+        hi = glm::max(hi, positions[i]);
+    }
+
+    TriangleBVH bvh;
+    double build_1 = timeMs([&] {
+        bvh.addMesh(positions, indices);
+        bvh.build(1);
+    });
+    bvh.clear();
+    double build_n = timeMs([&] {
+        bvh.addMesh(positions, indices);
+        bvh.build(num_threads);
+    });
+    printf("%s: %zu triangles, %zu nodes, %d threads\n", filename.c_str(), bvh.getNumTriangles(), bvh.getNumNodes(), num_threads);
+    printf("  build 1 thread   %8.2f ms\n", build_1);
+    printf("  build %2d threads %8.2f ms\n", num_threads, build_n);
+
+    // Closest hit, then shadow rays from the hits towards a light above the camera
+    vector<RayHit> hits(IMAGE_SIZE * IMAGE_SIZE);
+    vector<char> has_hit(IMAGE_SIZE * IMAGE_SIZE);
+    size_t num_hits = 0, num_shadowed = 0, num_shadow_rays = 0;
+    double closest_ms = timeMs([&] {
+        num_hits = traceRows(num_threads, [&](int y) {
+            size_t row_hits = 0;
+            for (int x = 0; x < IMAGE_SIZE; x++) {
+                has_hit[y * IMAGE_SIZE + x] = bvh.intersect(cameraRay(lo, hi, x, y), &hits[y * IMAGE_SIZE + x]);
+                row_hits += has_hit[y * IMAGE_SIZE + x];
+            }
+            return row_hits;
+        });
+    });
+
+    vec3 light = (lo + hi) * 0.5f + vec3(-1.0f, 2.0f, 1.0f) * length(hi - lo);
+    for (char h : has_hit) {
+        num_shadow_rays += h;
+    }
+    double any_ms = timeMs([&] {
+        num_shadowed = traceRows(num_threads, [&](int y) {
+            size_t row_shadowed = 0;
+            for (int x = 0; x < IMAGE_SIZE; x++) {
+                if (!has_hit[y * IMAGE_SIZE + x]) {
+                    continue;
+                }
+                Ray camera = cameraRay(lo, hi, x, y);
+                vec3 p = camera.origin + camera.direction * hits[y * IMAGE_SIZE + x].t;
+                Ray shadow = { p, light - p, 1e-4f, 1.0f };
+                row_shadowed += bvh.occluded(shadow);
+            }
+            return row_shadowed;
+        });
+    });
+
+    size_t num_rays = IMAGE_SIZE * IMAGE_SIZE;
+    printf("  closest hit %8.2f ms %8.2f Mrays/s (%zu hits)\n", closest_ms, num_rays / closest_ms / 1000.0, num_hits);
+    printf("  any hit     %8.2f ms %8.2f Mrays/s (%zu shadowed)\n", any_ms, num_shadow_rays / any_ms / 1000.0, num_shadowed);
+
+    // Reference on a subset of the camera rays
+    size_t mismatches = 0;
+    srand(1);
+    for (int i = 0; i < NUM_CHECKED_RAYS; i++) {
+        int x = rand() % IMAGE_SIZE, y = rand() % IMAGE_SIZE;
+        float t;
+        bool found = bruteForce(positions, indices, cameraRay(lo, hi, x, y), &t);
+        const RayHit& hit = hits[y * IMAGE_SIZE + x];
+        if (found != (bool)has_hit[y * IMAGE_SIZE + x] || (found && fabs(t - hit.t) > 1e-4f * t)) {
+            mismatches++;
+        }
+    }
+    printf("  %d rays checked against every triangle, %zu mismatches\n", NUM_CHECKED_RAYS, mismatches);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * Throughput of the batch polygon clipper.
+ * Random regular polygons against the square clipper used in list9, then a
+ * concave comb whose teeth cross the clipper edges many times.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../clipping.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define NUM_POLYGONS 200000
+#define COMB_TEETH 64
+
+int main(int argc, char** argv) {
+    int num_sides = argc > 1 ? atoi(argv[1]) : 8;
+
+    vector<vec2> clipper{ vec2(-0.5f, -0.5f), vec2(0.5f, -0.5f), vec2(0.5f, 0.5f), vec2(-0.5f, 0.5f) };
+    PolygonList polys;
+    vector<vec2> poly(num_sides);
+
+    srand(1);
+    for (int i = 0; i < NUM_POLYGONS; i++) {
+        vec2 center(rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f);
+        float radius = 0.05f + rand() / (float)RAND_MAX * 0.4f;
+        for (int k = 0; k < num_sides; k++) {
+            float angle = 6.2831853f * k / num_sides;
+            poly[k] = center + radius * vec2(cos(angle), sin(angle));
+        }
+        polys.add(poly.data(), poly.size());
+    }
+
+    PolygonClipper engine(clipper);
+    for (int num_threads : { 1, 0 }) {
+        PolygonList clipped;
+        double ms = timeMs([&] { clipped = engine.clipBatch(polys, num_threads); });
+        printf("%d-gons, %s: %.2f Mpolygons/s (%zu output vertices)\n", num_sides, num_threads == 1 ? "1 thread" : "all cores", NUM_POLYGONS / ms * 1e-3, clipped.vertices.size());
+    }
+
+    // Comb with pointed teeth, each tip above the clipper turns into two crossings of its top edge
+    vector<vec2> comb;
+    for (int k = 0; k < COMB_TEETH; k++) {
+        comb.push_back(vec2(-0.45f + 0.9f * k / COMB_TEETH, 0.0f));
+        comb.push_back(vec2(-0.45f + 0.9f * (k + 0.5f) / COMB_TEETH, 0.75f));
+    }
+    comb.push_back(vec2(0.45f, 0.0f));
+    comb.push_back(vec2(0.45f, -0.25f));
+    comb.push_back(vec2(-0.45f, -0.25f));
+
+    PolygonList combs;
+    for (int i = 0; i < NUM_POLYGONS / COMB_TEETH; i++) {
+        combs.add(comb.data(), comb.size());
+    }
+    vector<vec2> single = engine.clip(comb);
+    double ms = timeMs([&] { engine.clipBatch(combs, 1); });
+    printf("%zu-vertex comb: %zu vertices clipped, %.2f Mpolygons/s\n", comb.size(), single.size(), combs.size() / ms * 1e-3);
+    return 0;
+}
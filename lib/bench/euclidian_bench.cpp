@@ -0,0 +1,119 @@
+/**
+ * Microbenchmark of the lib/euclidian vector math APIs.
+ * Compares std::vector arguments, fixed size glm::vec3 and SoA batches.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../euclidian.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+// Small enough to stay in cache, measures compute rather than memory bandwidth
+#define NUM_VECTORS 100000
+#define NUM_RUNS 50
+
+// Previous API: arguments by value, one heap allocation per vector copy
+static float innerProductByValue(vector<float> v1, vector<float> v2) {
+    return v1[0] * v2[0] + v1[1] * v2[1] + v1[2] * v2[2];
+}
+
+static vector<float> crossProductByValue(vector<float> v1, vector<float> v2) {
+    return vector<float>{ v1[1] * v2[2] - v1[2] * v2[1], v1[2] * v2[0] - v1[0] * v2[2], v1[0] * v2[1] - v1[1] * v2[0] };
+}
+
+static float lenSquaredByValue(vector<float> v) {
+    return innerProductByValue(v, v);
+}
+
+static float lengthByValue(vector<float> v) {
+    return sqrt(lenSquaredByValue(v));
+}
+
+static float innerAngleByValue(vector<float> v1, vector<float> v2) {
+    float len_sq = lenSquaredByValue(v1) * lenSquaredByValue(v2);
+    return len_sq == 0 ? 0.0f : acos(innerProductByValue(v1, v2) / sqrt(len_sq));
+}
+
+static float distPoint2LineByValue(vector<float> p, vector<float> line_point, vector<float> line_vector) {
+    vector<float> ap{ p[0] - line_point[0], p[1] - line_point[1], p[2] - line_point[2] };
+    return sqrt(lenSquaredByValue(crossProductByValue(ap, line_vector)) / lenSquaredByValue(line_vector));
+}
+
+int main() {
+    vector<float> x1(NUM_VECTORS), y1(NUM_VECTORS), z1(NUM_VECTORS);
+    vector<float> x2(NUM_VECTORS), y2(NUM_VECTORS), z2(NUM_VECTORS);
+    vector<float> cx(NUM_VECTORS), cy(NUM_VECTORS), cz(NUM_VECTORS);
+    vector<float> out(NUM_VECTORS);
+    vector<vec3> a(NUM_VECTORS), b(NUM_VECTORS), c(NUM_VECTORS);
+    vector<vector<float>> va(NUM_VECTORS), vb(NUM_VECTORS);
+
+    srand(1);
+    for (int i = 0; i < NUM_VECTORS; i++) {
+        x1[i] = rand() / (float)RAND_MAX;
+        y1[i] = rand() / (float)RAND_MAX;
+        z1[i] = rand() / (float)RAND_MAX;
+        x2[i] = rand() / (float)RAND_MAX;
+        y2[i] = rand() / (float)RAND_MAX;
+        z2[i] = rand() / (float)RAND_MAX;
+        a[i] = vec3(x1[i], y1[i], z1[i]);
+        b[i] = vec3(x2[i], y2[i], z2[i]);
+        va[i] = { x1[i], y1[i], z1[i] };
+        vb[i] = { x2[i], y2[i], z2[i] };
+    }
+    Vec3Span span_a{ x1.data(), y1.data(), z1.data(), NUM_VECTORS };
+    Vec3Span span_b{ x2.data(), y2.data(), z2.data(), NUM_VECTORS };
+    Vec3Span span_c{ cx.data(), cy.data(), cz.data(), NUM_VECTORS };
+    vec3 line_point(0.5f, 0.5f, 0.5f);
+    vec3 line_vector(1.0f, 2.0f, 3.0f);
+    vector<float> line_point_v{ 0.5f, 0.5f, 0.5f };
+    vector<float> line_vector_v{ 1.0f, 2.0f, 3.0f };
+
+    float sink = 0.0f;
+    printf("%d vectors, best of %d runs (ms)\n", NUM_VECTORS, NUM_RUNS);
+    printf("%-16s %10s %10s %10s %10s\n", "", "by value", "vector&", "vec3", "batch");
+
+    double t_value = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerProductByValue(va[i], vb[i]); }, NUM_RUNS);
+    double t_vector = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerProduct(va[i], vb[i]); }, NUM_RUNS);
+    double t_vec3 = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerProduct(a[i], b[i]); }, NUM_RUNS);
+    double t_batch = bestTimeMs([&] { innerProductBatch(span_a, span_b, out.data()); }, NUM_RUNS);
+    sink += out[NUM_VECTORS / 2];
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f\n", "innerProduct", t_value, t_vector, t_vec3, t_batch);
+
+    t_value = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = crossProductByValue(va[i], vb[i])[0]; }, NUM_RUNS);
+    t_vector = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = crossProduct(va[i], vb[i])[0]; }, NUM_RUNS);
+    t_vec3 = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) c[i] = crossProduct(a[i], b[i]); }, NUM_RUNS);
+    t_batch = bestTimeMs([&] { crossProductBatch(span_a, span_b, span_c); }, NUM_RUNS);
+    sink += out[NUM_VECTORS / 2] + c[NUM_VECTORS / 2].x + cx[NUM_VECTORS / 2];
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f\n", "crossProduct", t_value, t_vector, t_vec3, t_batch);
+
+    t_value = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = lengthByValue(va[i]); }, NUM_RUNS);
+    t_vector = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = length(va[i]); }, NUM_RUNS);
+    t_vec3 = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = length(a[i]); }, NUM_RUNS);
+    t_batch = bestTimeMs([&] { lengthBatch(span_a, out.data()); }, NUM_RUNS);
+    sink += out[NUM_VECTORS / 2];
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f\n", "length", t_value, t_vector, t_vec3, t_batch);
+
+    t_value = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerAngleByValue(va[i], vb[i]); }, NUM_RUNS);
+    t_vector = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerAngle(va[i], vb[i]); }, NUM_RUNS);
+    t_vec3 = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = innerAngle(a[i], b[i]); }, NUM_RUNS);
+    t_batch = bestTimeMs([&] { innerAngleBatch(span_a, span_b, out.data()); }, NUM_RUNS);
+    sink += out[NUM_VECTORS / 2];
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f\n", "innerAngle", t_value, t_vector, t_vec3, t_batch);
+
+    t_value = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = distPoint2LineByValue(va[i], line_point_v, line_vector_v); }, NUM_RUNS);
+    t_vector = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = distPoint2Line(va[i], line_point_v, line_vector_v); }, NUM_RUNS);
+    t_vec3 = bestTimeMs([&] { for (int i = 0; i < NUM_VECTORS; i++) out[i] = distPoint2Line(a[i], line_point, line_vector); }, NUM_RUNS);
+    t_batch = bestTimeMs([&] { distPoint2LineBatch(span_a, line_point, line_vector, out.data()); }, NUM_RUNS);
+    sink += out[NUM_VECTORS / 2];
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f\n", "distPoint2Line", t_value, t_vector, t_vec3, t_batch);
+
+    // Keeps the results alive
+    printf("(%f)\n", sink);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * Half-space rasterization of random triangles on a 1920x1080 target.
+ * The block kernel (AVX2 when compiled with -mavx2 -mfma) is compared against
+ * testing every pixel of the bounding box with the scalar reference.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../halfspace.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define TARGET_WIDTH 1920
+#define TARGET_HEIGHT 1080
+#define NUM_TRIANGLES 20000
+
+static vector<HalfSpaceTriangle> randomTriangles(float size) {
+    vector<HalfSpaceTriangle> triangles;
+    while (triangles.size() < NUM_TRIANGLES) {
+        vec2 center(frand(0.0f, TARGET_WIDTH), frand(0.0f, TARGET_HEIGHT));
+        vec2 screen[3];
+        float z[3];
+        for (int k = 0; k < 3; k++) {
+            screen[k] = center + vec2(frand(-size, size), frand(-size, size));
+            z[k] = frand(0.0f, 1.0f);
+        }
+        HalfSpaceTriangle triangle;
+        if (setupHalfSpace(screen, z, &triangle)) {
+            triangles.push_back(triangle);
+        }
+    }
+    return triangles;
+}
+
+// Per pixel over the bounding box, same outputs as the kernel
+static size_t rasterizeReference(const vector<HalfSpaceTriangle>& triangles, float* sink) {
+    size_t covered = 0;
+    for (const HalfSpaceTriangle& t : triangles) {
+        int x0 = std::max(t.min_x, 0), y0 = std::max(t.min_y, 0);
+        int x1 = std::min(t.max_x, TARGET_WIDTH - 1), y1 = std::min(t.max_y, TARGET_HEIGHT - 1);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                if (!isCovered(t, x, y)) {
+                    continue;
+                }
+                float fx = (float)(x - t.min_x), fy = (float)(y - t.min_y);
+                float l1 = t.bary_c[1] + t.bary_a[1] * fx + t.bary_b[1] * fy;
+                float l2 = t.bary_c[2] + t.bary_a[2] * fx + t.bary_b[2] * fy;
+                *sink += t.z[0] + l1 * (t.z[1] - t.z[0]) + l2 * (t.z[2] - t.z[0]);
+                covered++;
+            }
+        }
+    }
+    return covered;
+}
+
+static size_t rasterizeKernel(const vector<HalfSpaceTriangle>& triangles, BlockShape shape, vector<RasterBlock>& blocks) {
+    size_t covered = 0;
+    for (const HalfSpaceTriangle& t : triangles) {
+        blocks.clear();
+        rasterizeBlocks(t, shape, 0, 0, TARGET_WIDTH - 1, TARGET_HEIGHT - 1, &blocks);
+        for (const RasterBlock& block : blocks) {
+            covered += __builtin_popcount(block.mask);
+        }
+    }
+    return covered;
+}
+
+int main() {
+    srand(1);
+#ifdef __AVX2__
+    printf("Kernel: AVX2\n");
+#else
+    printf("Kernel: scalar\n");
+#endif
+
+    const float sizes[] = { 4.0f, 16.0f, 64.0f, 256.0f };
+    vector<RasterBlock> blocks;
+    for (float size : sizes) {
+        vector<HalfSpaceTriangle> triangles = randomTriangles(size);
+        float sink = 0.0f;
+        size_t ref_pixels = 0, pixels_8x1 = 0, pixels_4x2 = 0;
+
+        double ref_ms = timeMs([&] { ref_pixels = rasterizeReference(triangles, &sink); });
+        double ms_8x1 = timeMs([&] { pixels_8x1 = rasterizeKernel(triangles, BLOCK_8X1, blocks); });
+        double ms_4x2 = timeMs([&] { pixels_4x2 = rasterizeKernel(triangles, BLOCK_4X2, blocks); });
+
+        printf("%d triangles up to %3.0f px, %zu pixels%s\n", NUM_TRIANGLES, size * 2.0f, ref_pixels, (pixels_8x1 == ref_pixels && pixels_4x2 == ref_pixels) ? "" : " (COVERAGE MISMATCH)");
+        printf("  reference %8.2f ms %8.1f Mpixels/s\n", ref_ms, ref_pixels / ref_ms / 1000.0);
+        printf("  8x1       %8.2f ms %8.1f Mpixels/s\n", ms_8x1, pixels_8x1 / ms_8x1 / 1000.0);
+        printf("  4x2       %8.2f ms %8.1f Mpixels/s\n", ms_4x2, pixels_4x2 / ms_4x2 / 1000.0);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * Raster primitives on a 4K RGB and RGBA texture.
+ * Spans are compared against writing each pixel with a per channel loop.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../euclidian.h"
+#include "../raster.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define TEXT_SIZE 4096
+#define REPEATS 10
+
+// What generateTexture used to do
+static void pixelClear(unsigned char* data, int channels, const unsigned char* color) {
+    for (int y = 0; y < TEXT_SIZE; y++) {
+        for (int x = 0; x < TEXT_SIZE; x++) {
+            for (int c = 0; c < channels; c++) {
+                data[((size_t)y * TEXT_SIZE + x) * channels + c] = color[c];
+            }
+        }
+    }
+}
+
+static void pixelFilledCircle(unsigned char* data, int channels, ivec2 center, int radius, const unsigned char* color) {
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            ivec2 p = center + ivec2(x, y);
+            if (x * x + y * y <= radius * radius && p.x >= 0 && p.x < TEXT_SIZE && p.y >= 0 && p.y < TEXT_SIZE) {
+                for (int c = 0; c < channels; c++) {
+                    data[((size_t)p.y * TEXT_SIZE + p.x) * channels + c] = color[c];
+                }
+            }
+        }
+    }
+}
+
+static void pixelOutline(unsigned char* data, int channels, ivec2 center, int radius, const unsigned char* color) {
+    for (ivec2 p : midPointCircleDraw(ivec2(0, 0), radius)) {
+        p += center;
+        if (p.x >= 0 && p.x < TEXT_SIZE && p.y >= 0 && p.y < TEXT_SIZE) {
+            for (int c = 0; c < channels; c++) {
+                data[((size_t)p.y * TEXT_SIZE + p.x) * channels + c] = color[c];
+            }
+        }
+    }
+}
+
+int main() {
+    const unsigned char color[4] = { 200, 30, 60, 255 };
+    ivec2 center(TEXT_SIZE / 2, TEXT_SIZE / 2);
+    int radius = TEXT_SIZE / 2 - 16;
+
+    vector<vec2> star;
+    for (int i = 0; i < 64; i++) {
+        float angle = 6.2831853f * i / 64;
+        float r = (i % 2 ? 0.45f : 0.2f) * TEXT_SIZE;
+        star.push_back(vec2(center) + r * vec2(cos(angle), sin(angle)));
+    }
+
+    for (int channels = 3; channels <= 4; channels++) {
+        vector<unsigned char> pixels((size_t)TEXT_SIZE * TEXT_SIZE * channels);
+        RasterImage image = rasterImage(pixels.data(), TEXT_SIZE, TEXT_SIZE, channels);
+        vector<Span> spans;
+        printf("%dx%d, %d channels\n", TEXT_SIZE, TEXT_SIZE, channels);
+
+        double pixel_ms = timeMs([&] { pixelClear(pixels.data(), channels, color); }, REPEATS);
+        double span_ms = timeMs([&] { clearImage(image, color); }, REPEATS);
+        printf("  clear          per pixel %8.2f ms   spans %8.2f ms\n", pixel_ms, span_ms);
+
+        pixel_ms = timeMs([&] { pixelFilledCircle(pixels.data(), channels, center, radius, color); }, REPEATS);
+        span_ms = timeMs([&] {
+            spans.clear();
+            circleSpans(image, center, radius, true, &spans);
+            fillSpans(image, spans, color);
+        }, REPEATS);
+        printf("  filled circle  per pixel %8.2f ms   spans %8.2f ms\n", pixel_ms, span_ms);
+
+        pixel_ms = timeMs([&] { pixelOutline(pixels.data(), channels, center, radius, color); }, REPEATS);
+        span_ms = timeMs([&] {
+            spans.clear();
+            circleSpans(image, center, radius, false, &spans);
+            fillSpans(image, spans, color);
+        }, REPEATS);
+        printf("  circle outline per pixel %8.2f ms   spans %8.2f ms\n", pixel_ms, span_ms);
+
+        span_ms = timeMs([&] {
+            spans.clear();
+            ellipseSpans(image, center, radius, radius / 2, true, &spans);
+            fillSpans(image, spans, color);
+        }, REPEATS);
+        printf("  filled ellipse                        spans %8.2f ms\n", span_ms);
+
+        span_ms = timeMs([&] {
+            spans.clear();
+            polygonSpans(image, star, &spans);
+            fillSpans(image, spans, color);
+        }, REPEATS);
+        printf("  64 vertex star                        spans %8.2f ms\n", span_ms);
+
+        span_ms = timeMs([&] {
+            spans.clear();
+            for (int i = 0; i < 1000; i++) {
+                lineSpans(image, ivec2(i * 4, 0), ivec2(TEXT_SIZE - 1 - i * 4, TEXT_SIZE - 1), &spans);
+            }
+            fillSpans(image, spans, color);
+        }, REPEATS);
+        printf("  1000 lines                            spans %8.2f ms\n", span_ms);
+    }
+    return 0;
+}
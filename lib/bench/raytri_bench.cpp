@@ -0,0 +1,207 @@
+/**
+ * Ray/triangle kernels: the watertight test (single ray, 1 ray x 8 triangles,
+ * 8 rays x 1 triangle, AVX2 when compiled with -mavx2) is checked against the
+ * plane + point in triangle test of list7, then rays are shot at the shared
+ * edges and vertices of a grid to count the ones passing through it.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../raytri.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define NUM_TRIANGLES 1024
+#define NUM_RAYS 4096
+#define GRID_SIZE 64
+
+struct Triangle {
+    vec3 v0, v1, v2;
+};
+
+// list7/question2.cpp
+static bool point_in_triangle(vec3 p1, vec3 p2, vec3 p3, vec3 p) {
+    vec3 a = p1 - p;
+    vec3 b = p2 - p;
+    vec3 c = p3 - p;
+
+    vec3 u = cross(b, c);
+    vec3 v = cross(c, a);
+    vec3 w = cross(a, b);
+
+    if (dot(u, v) < 0.0f) {
+        return false;
+    }
+
+    if (dot(u, w) < 0.0f) {
+        return false;
+    }
+
+    return true;
+}
+
+// list7's print_intersection without the output, direction normalized
+static bool list7Intersection(const Triangle& tri, vec3 origin, vec3 direction, float* t) {
+    vec3 normal = cross(tri.v1 - tri.v0, tri.v2 - tri.v0);
+    float normal_vec_dot = dot(normal, direction);
+    if (abs(normal_vec_dot) <= 0.0001f) {
+        return false;
+    }
+    *t = dot(tri.v0 - origin, normal) / normal_vec_dot;
+    return *t > 0.0f && point_in_triangle(tri.v0, tri.v1, tri.v2, origin + direction * *t);
+}
+
+// Moller-Trumbore, for the grid
+static bool mollerTrumbore(const Triangle& tri, vec3 origin, vec3 direction) {
+    vec3 e1 = tri.v1 - tri.v0, e2 = tri.v2 - tri.v0;
+    vec3 p = cross(direction, e2);
+    float det = dot(e1, p);
+    if (det == 0.0f) {
+        return false;
+    }
+    vec3 s = origin - tri.v0;
+    float u = dot(s, p) / det;
+    vec3 q = cross(s, e1);
+    float v = dot(direction, q) / det;
+    return u >= 0.0f && v >= 0.0f && u + v <= 1.0f && dot(e2, q) / det > 0.0f;
+}
+
+int main() {
+    srand(1);
+#ifdef __AVX2__
+    printf("Kernels: AVX2\n");
+#else
+    printf("Kernels: scalar\n");
+#endif
+
+    // Rays aimed near each triangle
+    vector<Triangle> triangles(NUM_TRIANGLES);
+    vector<vec3> origins(NUM_RAYS), directions(NUM_RAYS);
+    for (Triangle& tri : triangles) {
+        vec3 center = vrand(-1.0f, 1.0f);
+        tri = { center + vrand(-0.2f, 0.2f), center + vrand(-0.2f, 0.2f), center + vrand(-0.2f, 0.2f) };
+    }
+    for (int i = 0; i < NUM_RAYS; i++) {
+        const Triangle& tri = triangles[i % NUM_TRIANGLES];
+        origins[i] = vrand(-3.0f, 3.0f);
+        directions[i] = normalize((tri.v0 + tri.v1 + tri.v2) / 3.0f + vrand(-0.15f, 0.15f) - origins[i]);
+    }
+
+    vector<TrianglePacket> triangle_packets(NUM_TRIANGLES / RAY_PACKET_SIZE);
+    for (int i = 0; i < NUM_TRIANGLES; i++) {
+        setTriangle(&triangle_packets[i / RAY_PACKET_SIZE], i % RAY_PACKET_SIZE, triangles[i].v0, triangles[i].v1, triangles[i].v2);
+    }
+    vector<WatertightRayPacket> ray_packets(NUM_RAYS / RAY_PACKET_SIZE);
+    for (int p = 0; p < NUM_RAYS / RAY_PACKET_SIZE; p++) {
+        RayPacket rays;
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            for (int k = 0; k < 3; k++) {
+                rays.origin[k][i] = origins[p * RAY_PACKET_SIZE + i][k];
+                rays.direction[k][i] = directions[p * RAY_PACKET_SIZE + i][k];
+            }
+            rays.t_min[i] = 0.0f;
+            rays.t_max[i] = INFINITY;
+        }
+        setupRays(rays, &ray_packets[p]);
+    }
+
+    // (1) Every ray against its own triangle: scalar against list7, packets against scalar
+    size_t hits = 0, list7_mismatches = 0, packet_mismatches = 0;
+    for (int i = 0; i < NUM_RAYS; i++) {
+        const Triangle& tri = triangles[i % NUM_TRIANGLES];
+        WatertightRay ray = setupRay(origins[i], directions[i]);
+        TriangleHit hit;
+        bool found = intersectTriangle(ray, tri.v0, tri.v1, tri.v2, 0.0f, INFINITY, &hit);
+        float t_list7;
+        bool found_list7 = list7Intersection(tri, origins[i], directions[i], &t_list7);
+        hits += found;
+        if (found != found_list7 || (found && fabs(hit.t - t_list7) > 1e-4f * t_list7)) {
+            list7_mismatches++;
+        }
+
+        PacketHit tri_hits, ray_hits;
+        int lane = (i % NUM_TRIANGLES) % RAY_PACKET_SIZE;
+        bool found_1x8 = intersectTriangles(ray, triangle_packets[(i % NUM_TRIANGLES) / RAY_PACKET_SIZE], 0.0f, INFINITY, &tri_hits) >> lane & 1;
+        bool found_8x1 = intersectRays(ray_packets[i / RAY_PACKET_SIZE], tri.v0, tri.v1, tri.v2, &ray_hits) >> (i % RAY_PACKET_SIZE) & 1;
+        if (found_1x8 != found || found_8x1 != found) {
+            packet_mismatches++;
+        } else if (found && (tri_hits.t[lane] != hit.t || tri_hits.u[lane] != hit.u || ray_hits.t[i % RAY_PACKET_SIZE] != hit.t || ray_hits.v[i % RAY_PACKET_SIZE] != hit.v)) {
+            packet_mismatches++;
+        }
+    }
+    printf("%d rays: %zu hits, %zu mismatches against list7, %zu between packets and single rays\n", NUM_RAYS, hits, list7_mismatches, packet_mismatches);
+
+    // (2) Rays through the vertices and edge midpoints of a bumpy grid, none should get through
+    vector<Triangle> grid;
+    auto gridVertex = [](int x, int y) { return vec3(x / (float)GRID_SIZE, y / (float)GRID_SIZE, 0.05f * sinf(x * 0.7f) * cosf(y * 1.3f)); };
+    for (int y = 0; y < GRID_SIZE; y++) {
+        for (int x = 0; x < GRID_SIZE; x++) {
+            grid.push_back({ gridVertex(x, y), gridVertex(x + 1, y), gridVertex(x + 1, y + 1) });
+            grid.push_back({ gridVertex(x, y), gridVertex(x + 1, y + 1), gridVertex(x, y + 1) });
+        }
+    }
+    size_t grid_rays = 0, leaks = 0, leaks_list7 = 0, leaks_mt = 0;
+    vec3 eye(0.37f, 0.61f, 2.0f);
+    for (int y = 1; y < GRID_SIZE; y++) {
+        for (int x = 1; x < GRID_SIZE; x++) {
+            vec3 targets[3] = { gridVertex(x, y), (gridVertex(x, y) + gridVertex(x + 1, y + 1)) * 0.5f, (gridVertex(x, y) + gridVertex(x + 1, y)) * 0.5f };
+            for (vec3 target : targets) {
+                vec3 direction = target - eye;
+                WatertightRay ray = setupRay(eye, direction);
+                bool hit = false, hit_list7 = false, hit_mt = false;
+                for (const Triangle& tri : grid) {
+                    TriangleHit h;
+                    float t;
+                    hit = hit || intersectTriangle(ray, tri.v0, tri.v1, tri.v2, 0.0f, INFINITY, &h);
+                    hit_list7 = hit_list7 || list7Intersection(tri, eye, normalize(direction), &t);
+                    hit_mt = hit_mt || mollerTrumbore(tri, eye, direction);
+                }
+                grid_rays++;
+                leaks += !hit;
+                leaks_list7 += !hit_list7;
+                leaks_mt += !hit_mt;
+            }
+        }
+    }
+    printf("%zu rays at shared edges and vertices getting through: watertight %zu, list7 %zu, Moller-Trumbore %zu\n", grid_rays, leaks, leaks_list7, leaks_mt);
+
+    // (3) Every ray against every triangle
+    size_t count_scalar = 0, count_1x8 = 0, count_8x1 = 0;
+    double scalar_ms = timeMs([&] {
+        for (int i = 0; i < NUM_RAYS; i++) {
+            WatertightRay ray = setupRay(origins[i], directions[i]);
+            for (const Triangle& tri : triangles) {
+                TriangleHit hit;
+                count_scalar += intersectTriangle(ray, tri.v0, tri.v1, tri.v2, 0.0f, INFINITY, &hit);
+            }
+        }
+    });
+    double ms_1x8 = timeMs([&] {
+        PacketHit packet_hits;
+        for (int i = 0; i < NUM_RAYS; i++) {
+            WatertightRay ray = setupRay(origins[i], directions[i]);
+            for (const TrianglePacket& packet : triangle_packets) {
+                count_1x8 += __builtin_popcount(intersectTriangles(ray, packet, 0.0f, INFINITY, &packet_hits));
+            }
+        }
+    });
+    double ms_8x1 = timeMs([&] {
+        PacketHit packet_hits;
+        for (const WatertightRayPacket& rays : ray_packets) {
+            for (const Triangle& tri : triangles) {
+                count_8x1 += __builtin_popcount(intersectRays(rays, tri.v0, tri.v1, tri.v2, &packet_hits));
+            }
+        }
+    });
+
+    double tests = (double)NUM_RAYS * NUM_TRIANGLES;
+    printf("%d rays x %d triangles, %zu hits%s\n", NUM_RAYS, NUM_TRIANGLES, count_scalar, (count_1x8 == count_scalar && count_8x1 == count_scalar) ? "" : " (HIT COUNT MISMATCH)");
+    printf("  single ray  %8.2f ms %8.1f Mtests/s %8.3f Mrays/s\n", scalar_ms, tests / scalar_ms / 1000.0, NUM_RAYS / scalar_ms / 1000.0);
+    printf("  1 ray x 8   %8.2f ms %8.1f Mtests/s %8.3f Mrays/s\n", ms_1x8, tests / ms_1x8 / 1000.0, NUM_RAYS / ms_1x8 / 1000.0);
+    printf("  8 rays x 1  %8.2f ms %8.1f Mtests/s %8.3f Mrays/s\n", ms_8x1, tests / ms_8x1 / 1000.0, NUM_RAYS / ms_8x1 / 1000.0);
+    return 0;
+}
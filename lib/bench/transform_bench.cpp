@@ -0,0 +1,133 @@
+/**
+ * World matrices of 100k animated objects (1000 roots with 99 children each):
+ * the TransformStore batch update (AVX2 when compiled with -mavx2) against
+ * composing one glm::mat4 per object, like SceneMesh does. Both write into an
+ * instance buffer, checked against each other.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../transforms.h"
+#include "bench.h"
+
+using namespace std;
+using namespace glm;
+
+#define NUM_ROOTS 1000
+#define CHILDREN_PER_ROOT 99
+#define NUM_FRAMES 50
+
+struct Object {
+    int parent;
+    vec3 translation;
+    quat rotation;
+    vec3 scale;
+};
+
+static quat qrand() {
+    float x = frand(-1.0f, 1.0f), y = frand(-1.0f, 1.0f), z = frand(-1.0f, 1.0f), w = frand(-1.0f, 1.0f);
+    float length = sqrtf(x * x + y * y + z * z + w * w);
+    return quat(w / length, x / length, y / length, z / length);
+}
+
+// Rotation of each object in a frame, around its own axis
+static quat animate(const quat& rotation, int frame) {
+    float angle = 0.01f * frame;
+    return quat(rotation.w * cosf(angle), rotation.x, rotation.y * cosf(angle), rotation.z * sinf(angle) + 0.1f);
+}
+
+static quat unit(const quat& q) {
+    float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    return quat(q.w / length, q.x / length, q.y / length, q.z / length);
+}
+
+static void fillStore(const vector<Object>& objects, TransformStore* store) {
+    store->clear();
+    for (const Object& object : objects) {
+        store->addObject(object.parent, object.translation, object.rotation, object.scale);
+    }
+}
+
+int main() {
+    srand(1);
+#ifdef __AVX2__
+    printf("Batches: AVX2\n");
+#else
+    printf("Batches: scalar\n");
+#endif
+
+    // Breadth first: roots, then the children
+    vector<Object> objects;
+    for (int i = 0; i < NUM_ROOTS; i++) {
+        objects.push_back({ TRANSFORM_ROOT, vec3(frand(-100.0f, 100.0f), 0.0f, frand(-100.0f, 100.0f)), qrand(), vec3(frand(0.5f, 2.0f)) });
+    }
+    for (int i = 0; i < NUM_ROOTS * CHILDREN_PER_ROOT; i++) {
+        vec3 offset(frand(-5.0f, 5.0f), frand(-5.0f, 5.0f), frand(-5.0f, 5.0f));
+        objects.push_back({ rand() % NUM_ROOTS, offset, qrand(), vec3(frand(0.5f, 2.0f), frand(0.5f, 2.0f), frand(0.5f, 2.0f)) });
+    }
+    size_t num_objects = objects.size();
+
+    TransformStore store;
+    fillStore(objects, &store);
+
+    vector<float> glm_buffer(num_objects * TRANSFORM_MATRIX_FLOATS);
+    vector<float> store_buffer(num_objects * TRANSFORM_MATRIX_FLOATS);
+    vector<mat4> worlds(num_objects);
+
+    double glm_ms = 0.0, store_ms = 0.0;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        vector<quat> rotations(num_objects);
+        for (size_t i = 0; i < num_objects; i++) {
+            rotations[i] = unit(animate(objects[i].rotation, frame));
+        }
+
+        glm_ms += timeMs([&] {
+            for (size_t i = 0; i < num_objects; i++) {
+                const Object& object = objects[i];
+                mat4 local = translate(mat4(1.0f), object.translation) * mat4_cast(rotations[i]) * scale(mat4(1.0f), object.scale);
+                worlds[i] = object.parent == TRANSFORM_ROOT ? local : worlds[object.parent] * local;
+                memcpy(&glm_buffer[i * TRANSFORM_MATRIX_FLOATS], &worlds[i][0][0], sizeof(mat4));
+            }
+        });
+
+        for (size_t i = 0; i < num_objects; i++) {
+            store.setRotation((unsigned int)i, rotations[i]);
+        }
+        store_ms += timeMs([&] { store.updateWorldMatrices(store_buffer.data()); });
+    }
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < glm_buffer.size(); i++) {
+        max_error = fmaxf(max_error, fabsf(glm_buffer[i] - store_buffer[i]));
+    }
+
+    printf("%zu objects, %d frames, max difference %g\n", num_objects, NUM_FRAMES, max_error);
+    printf("  glm::mat4 per object  %8.3f ms/frame %8.1f Mobjects/s\n", glm_ms / NUM_FRAMES, num_objects * NUM_FRAMES / glm_ms / 1000.0);
+    printf("  TransformStore        %8.3f ms/frame %8.1f Mobjects/s\n", store_ms / NUM_FRAMES, num_objects * NUM_FRAMES / store_ms / 1000.0);
+
+    // Depth first: each root followed by its children, batches holding a root are composed one object at a time
+    vector<Object> depth_first;
+    for (int i = 0; i < NUM_ROOTS; i++) {
+        int root = (int)depth_first.size();
+        depth_first.push_back(objects[i]);
+        for (int j = 0; j < CHILDREN_PER_ROOT; j++) {
+            Object child = objects[NUM_ROOTS + i * CHILDREN_PER_ROOT + j];
+            child.parent = root;
+            depth_first.push_back(child);
+        }
+    }
+    fillStore(depth_first, &store);
+    double depth_first_ms = timeMs([&] {
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            store.updateWorldMatrices(store_buffer.data());
+        }
+    });
+    printf("  depth first order     %8.3f ms/frame %8.1f Mobjects/s (%u of %zu batches serial)\n", depth_first_ms / NUM_FRAMES, num_objects * NUM_FRAMES / depth_first_ms / 1000.0,
+           store.getNumSerialBatches(), (num_objects + TRANSFORM_BATCH - 1) / TRANSFORM_BATCH);
+    return 0;
+}
@@ -0,0 +1,560 @@
+#include "boolean.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <set>
+#include <unordered_set>
+
+using namespace std;
+using namespace glm;
+
+// Crossings closer than this (edge parameter) to a vertex are degenerate
+#define DEGENERATE_EPSILON 1e-9
+
+// Clipper perturbation attempts before giving up on degenerate inputs
+#define MAX_PERTURBATIONS 8
+
+namespace {
+
+struct Point {
+    double x, y;
+};
+
+struct Node {
+    Point p;
+    int next, prev;
+    int neighbor;
+    bool is_intersection;
+    bool entry;
+    bool visited;
+};
+
+struct Crossing {
+    int subject_edge, clipper_edge;
+    double subject_alpha, clipper_alpha;
+    Point p;
+};
+
+// Edge from its leftmost (then lowest) end point
+struct SweepEdge {
+    Point left, right;
+    double slope;
+    int polygon;
+    int index;
+    bool forward;  // left is the first point of the polygon edge
+};
+
+// Polygon vertex between edges a (into it) and b (out of it), or crossing of edges a (below) and b
+struct SweepEvent {
+    double x, y;
+    int a, b;
+
+    bool operator>(const SweepEvent& other) const {
+        if (x != other.x) {
+            return x > other.x;
+        }
+        return y > other.y;
+    }
+};
+
+struct SweepState {
+    const vector<SweepEdge>* edges;
+    double x, y;
+};
+
+// Status entry, the edge is swapped in place at crossings so the tree never reorders
+struct StatusSlot {
+    mutable int edge;
+};
+
+double sweepY(const SweepEdge& e, const SweepState& state) {
+    if (e.right.x == e.left.x) {
+        return std::min(std::max(state.y, e.left.y), e.right.y);
+    }
+    double x = std::min(std::max(state.x, e.left.x), e.right.x);
+    return e.left.y + e.slope * (x - e.left.x);
+}
+
+// Bottom to top at the sweep position, edges leaving the same point by slope.
+// Only used to place inserted edges, removals and swaps go through stored iterators
+struct StatusOrder {
+    const SweepState* state;
+
+    bool operator()(const StatusSlot& a, const StatusSlot& b) const {
+        const SweepEdge& ea = (*state->edges)[a.edge];
+        const SweepEdge& eb = (*state->edges)[b.edge];
+        double ya = sweepY(ea, *state);
+        double yb = sweepY(eb, *state);
+        if (ya != yb) {
+            return ya < yb;
+        }
+        if (ea.slope != eb.slope) {
+            return ea.slope < eb.slope;
+        }
+        return a.edge < b.edge;
+    }
+};
+
+double cross(Point a, Point b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+Point sub(Point a, Point b) {
+    return Point{ a.x - b.x, a.y - b.y };
+}
+
+// 0: no crossing, 1: proper crossing, -1: degenerate (touching, collinear overlap)
+int intersectEdges(Point s0, Point s1, Point c0, Point c1, double* t, double* u) {
+    Point r = sub(s1, s0);
+    Point q = sub(c1, c0);
+    Point d = sub(c0, s0);
+    double den = cross(r, q);
+    double scale = sqrt((r.x * r.x + r.y * r.y) * (q.x * q.x + q.y * q.y));
+
+    if (fabs(den) <= 1e-14 * scale) {
+        // Parallel: degenerate only if collinear and overlapping
+        if (fabs(cross(d, r)) > 1e-14 * scale + 1e-300) {
+            return 0;
+        }
+        double len_sq = r.x * r.x + r.y * r.y;
+        double a = (d.x * r.x + d.y * r.y) / len_sq;
+        double b = ((c1.x - s0.x) * r.x + (c1.y - s0.y) * r.y) / len_sq;
+        return (std::max(a, b) < 0.0 || std::min(a, b) > 1.0) ? 0 : -1;
+    }
+
+    *t = cross(d, q) / den;
+    *u = cross(d, r) / den;
+    if (*t < -DEGENERATE_EPSILON || *t > 1.0 + DEGENERATE_EPSILON || *u < -DEGENERATE_EPSILON || *u > 1.0 + DEGENERATE_EPSILON) {
+        return 0;
+    }
+    if (*t < DEGENERATE_EPSILON || *t > 1.0 - DEGENERATE_EPSILON || *u < DEGENERATE_EPSILON || *u > 1.0 - DEGENERATE_EPSILON) {
+        return -1;
+    }
+    return 1;
+}
+
+// Bentley-Ottmann sweep over the edges of both polygons, O((n + k) log n) for k crossings (self
+// crossings included). Returns false on a degenerate subject/clipper crossing
+bool findCrossings(const vector<Point>& subject, const vector<Point>& clipper, vector<Crossing>* crossings) {
+    const vector<Point>* polygons[2] = { &subject, &clipper };
+    vector<SweepEdge> edges;
+    edges.reserve(subject.size() + clipper.size());
+    vector<SweepEvent> vertices;
+    vertices.reserve(subject.size() + clipper.size());
+    for (int poly = 0; poly < 2; poly++) {
+        const vector<Point>& points = *polygons[poly];
+        int first = (int)edges.size();
+        int n = (int)points.size();
+        for (int i = 0; i < n; i++) {
+            Point a = points[i];
+            Point b = points[(i + 1) % n];
+            bool forward = a.x < b.x || (a.x == b.x && a.y < b.y);
+            SweepEdge edge{ forward ? a : b, forward ? b : a, HUGE_VAL, poly, i, forward };
+            if (edge.right.x != edge.left.x) {
+                edge.slope = (edge.right.y - edge.left.y) / (edge.right.x - edge.left.x);
+            }
+            edges.push_back(edge);
+            vertices.push_back(SweepEvent{ a.x, a.y, first + (i + n - 1) % n, first + i });
+        }
+    }
+    // Vertices are known up front (popped from the back), only crossings go through the queue
+    sort(vertices.begin(), vertices.end(), greater<SweepEvent>());
+    priority_queue<SweepEvent, vector<SweepEvent>, greater<SweepEvent>> events;
+
+    SweepState state{ &edges, 0.0, 0.0 };
+    typedef set<StatusSlot, StatusOrder> Status;
+    Status status(StatusOrder{ &state });
+    vector<Status::iterator> where(edges.size());
+    vector<bool> active(edges.size(), false);
+
+    // Two segments cross at most once, each pair is swapped once
+    unordered_set<unsigned long long> swapped;
+    auto pairKey = [&](int a, int b) { return (unsigned long long)std::min(a, b) * edges.size() + std::max(a, b); };
+
+    // Edge parameters of a crossing, subject first
+    auto intersectPair = [&](const SweepEdge& a, const SweepEdge& b, double* t, double* u) {
+        const SweepEdge& s = a.polygon <= b.polygon ? a : b;
+        const SweepEdge& c = a.polygon <= b.polygon ? b : a;
+        const vector<Point>& s_points = *polygons[s.polygon];
+        const vector<Point>& c_points = *polygons[c.polygon];
+        return intersectEdges(s_points[s.index], s_points[(s.index + 1) % s_points.size()], c_points[c.index], c_points[(c.index + 1) % c_points.size()], t, u);
+    };
+
+    bool degenerate = false;
+    auto testPair = [&](Status::iterator lower) {
+        if (lower == status.end() || next(lower) == status.end()) {
+            return;
+        }
+        int a = lower->edge;
+        int b = next(lower)->edge;
+        const SweepEdge& ea = edges[a];
+        const SweepEdge& eb = edges[b];
+        // Consecutive edges of one polygon only meet at their shared vertex
+        if (ea.polygon == eb.polygon) {
+            int n = (int)polygons[ea.polygon]->size();
+            if ((ea.index + 1) % n == eb.index || (eb.index + 1) % n == ea.index) {
+                return;
+            }
+        }
+        // Disjoint in y, their x spans already overlap
+        if (std::max(ea.left.y, ea.right.y) < std::min(eb.left.y, eb.right.y) || std::max(eb.left.y, eb.right.y) < std::min(ea.left.y, ea.right.y)) {
+            return;
+        }
+        if (swapped.count(pairKey(a, b))) {
+            return;
+        }
+
+        double t, u;
+        int result = intersectPair(ea, eb, &t, &u);
+        if (result < 0 && ea.polygon != eb.polygon) {
+            degenerate = true;
+        }
+        if (result > 0) {
+            const SweepEdge& s = ea.polygon <= eb.polygon ? ea : eb;
+            const vector<Point>& points = *polygons[s.polygon];
+            Point s0 = points[s.index];
+            Point s1 = points[(s.index + 1) % points.size()];
+            // Kept inside both spans, rounding past a vertical edge would order it after the edge ends
+            double x = std::min(std::max(s0.x + (s1.x - s0.x) * t, std::max(ea.left.x, eb.left.x)), std::min(ea.right.x, eb.right.x));
+            double y = s0.y + (s1.y - s0.y) * t;
+            for (const SweepEdge* e : { &ea, &eb }) {
+                if (e->left.x == e->right.x) {
+                    y = std::min(std::max(y, e->left.y), e->right.y);
+                }
+            }
+            events.push(SweepEvent{ x, y, a, b });
+        }
+    };
+
+    // Crossings strictly before the next vertex go first, a vertex closes its edges before opening new ones
+    while ((!vertices.empty() || !events.empty()) && !degenerate) {
+        if (!events.empty() && (vertices.empty() || vertices.back() > events.top())) {
+            SweepEvent event = events.top();
+            events.pop();
+            state.x = event.x;
+            state.y = event.y;
+
+            // Stale once an edge ended or the pair is no longer adjacent in this order
+            if (!active[event.a] || !active[event.b]) {
+                continue;
+            }
+            Status::iterator lower = where[event.a];
+            Status::iterator upper = next(lower);
+            if (upper == status.end() || upper->edge != event.b || swapped.count(pairKey(event.a, event.b))) {
+                continue;
+            }
+            swapped.insert(pairKey(event.a, event.b));
+
+            const SweepEdge& ea = edges[event.a];
+            const SweepEdge& eb = edges[event.b];
+            if (ea.polygon != eb.polygon) {
+                double t, u;
+                intersectPair(ea, eb, &t, &u);
+                const SweepEdge& s = ea.polygon == 0 ? ea : eb;
+                const SweepEdge& c = ea.polygon == 0 ? eb : ea;
+                crossings->push_back(Crossing{ s.index, c.index, t, u, Point{ event.x, event.y } });
+            }
+
+            lower->edge = event.b;
+            upper->edge = event.a;
+            where[event.b] = lower;
+            where[event.a] = upper;
+            if (lower != status.begin()) {
+                testPair(prev(lower));
+            }
+            testPair(upper);
+            continue;
+        }
+
+        SweepEvent vertex = vertices.back();
+        vertices.pop_back();
+        state.x = vertex.x;
+        state.y = vertex.y;
+
+        // Edge a comes into the vertex, b leaves it
+        int ending[2] = { edges[vertex.a].forward ? vertex.a : -1, edges[vertex.b].forward ? -1 : vertex.b };
+        int starting[2] = { ending[0] < 0 ? vertex.a : -1, ending[1] < 0 ? vertex.b : -1 };
+        for (int e : ending) {
+            // Zero length edges are never inserted
+            if (e < 0 || !active[e]) {
+                continue;
+            }
+            Status::iterator it = where[e];
+            bool has_below = it != status.begin();
+            Status::iterator below = has_below ? prev(it) : status.end();
+            status.erase(it);
+            active[e] = false;
+            if (has_below) {
+                testPair(below);
+            }
+        }
+        for (int e : starting) {
+            if (e < 0 || (edges[e].left.x == edges[e].right.x && edges[e].left.y == edges[e].right.y)) {
+                continue;
+            }
+            Status::iterator it = status.insert(StatusSlot{ e }).first;
+            where[e] = it;
+            active[e] = true;
+            if (it != status.begin()) {
+                testPair(prev(it));
+            }
+            testPair(it);
+        }
+    }
+    return !degenerate;
+}
+
+bool isInside(Point p, const vector<Point>& polygon) {
+    // Even-odd crossing test
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        Point a = polygon[i];
+        Point b = polygon[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// Vertices and their edge crossings (sorted by alpha) as one circular list, returns the head node
+int buildList(const vector<Point>& points, vector<vector<pair<double, int>>>& edge_crossings, vector<Node>& nodes) {
+    int head = (int)nodes.size();
+    vector<int> ring;
+    for (size_t i = 0; i < points.size(); i++) {
+        ring.push_back((int)nodes.size());
+        nodes.push_back(Node{ points[i], -1, -1, -1, false, false, false });
+
+        sort(edge_crossings[i].begin(), edge_crossings[i].end());
+        for (const pair<double, int>& c : edge_crossings[i]) {
+            ring.push_back(c.second);
+        }
+    }
+    for (size_t i = 0; i < ring.size(); i++) {
+        nodes[ring[i]].next = ring[(i + 1) % ring.size()];
+        nodes[ring[i]].prev = ring[(i + ring.size() - 1) % ring.size()];
+    }
+    return head;
+}
+
+void markEntries(vector<Node>& nodes, int head, const vector<Point>& other, bool flip) {
+    bool inside = isInside(nodes[head].p, other);
+    int cur = head;
+    do {
+        if (nodes[cur].is_intersection) {
+            nodes[cur].entry = (!inside) != flip;
+            inside = !inside;
+        }
+        cur = nodes[cur].next;
+    } while (cur != head);
+}
+
+vector<vec2> toVec2(const vector<Point>& points, bool reverse) {
+    vector<vec2> out;
+    for (const Point& p : points) {
+        out.push_back(vec2((float)p.x, (float)p.y));
+    }
+    if (reverse) {
+        std::reverse(out.begin(), out.end());
+    }
+    return out;
+}
+
+vector<vector<vec2>> nestedResult(const vector<Point>& subject, const vector<Point>& clipper, BooleanOp op) {
+    // No crossings: disjoint or one inside the other
+    bool subject_in_clipper = isInside(subject[0], clipper);
+    bool clipper_in_subject = isInside(clipper[0], subject);
+    vector<vector<vec2>> result;
+
+    switch (op) {
+        case BOOLEAN_INTERSECTION:
+            if (subject_in_clipper) {
+                result.push_back(toVec2(subject, false));
+            } else if (clipper_in_subject) {
+                result.push_back(toVec2(clipper, false));
+            }
+            break;
+        case BOOLEAN_UNION:
+            if (subject_in_clipper) {
+                result.push_back(toVec2(clipper, false));
+            } else if (clipper_in_subject) {
+                result.push_back(toVec2(subject, false));
+            } else {
+                result.push_back(toVec2(subject, false));
+                result.push_back(toVec2(clipper, false));
+            }
+            break;
+        case BOOLEAN_DIFFERENCE:
+            if (!subject_in_clipper) {
+                result.push_back(toVec2(subject, false));
+                if (clipper_in_subject) {
+                    // Hole, wound by normalizeWinding
+                    result.push_back(toVec2(clipper, false));
+                }
+            }
+            break;
+    }
+    return result;
+}
+
+vector<Point> toPoints(const vector<vec2>& polygon) {
+    vector<Point> points;
+    for (vec2 v : polygon) {
+        points.push_back(Point{ v.x, v.y });
+    }
+    return points;
+}
+
+double signedArea(const vector<Point>& ring) {
+    double area = 0.0;
+    for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+        area += cross(ring[j], ring[i]);
+    }
+    return area * 0.5;
+}
+
+// Nesting samples per ring, a majority vote against rounding near the shared crossings
+#define NESTING_SAMPLES 3
+
+// Result rings only share crossing points, never edges, so edge midpoints are off the other ring
+bool isRingInside(const vector<Point>& ring, const vector<Point>& other) {
+    int votes = 0;
+    for (size_t k = 0; k < NESTING_SAMPLES; k++) {
+        size_t i = k * ring.size() / NESTING_SAMPLES;
+        size_t j = (i + 1) % ring.size();
+        Point mid{ (ring[i].x + ring[j].x) * 0.5, (ring[i].y + ring[j].y) * 0.5 };
+        votes += isInside(mid, other) ? 1 : -1;
+    }
+    return votes > 0;
+}
+
+// The walk returns rings in traversal order: outer rings become counter clockwise, holes
+// (inside an odd number of other rings) clockwise
+void normalizeWinding(vector<vector<vec2>>& result) {
+    vector<vector<Point>> rings;
+    vector<Point> lo, hi;
+    for (const vector<vec2>& ring : result) {
+        rings.push_back(toPoints(ring));
+        Point l = rings.back()[0], h = rings.back()[0];
+        for (const Point& p : rings.back()) {
+            l = Point{ std::min(l.x, p.x), std::min(l.y, p.y) };
+            h = Point{ std::max(h.x, p.x), std::max(h.y, p.y) };
+        }
+        lo.push_back(l);
+        hi.push_back(h);
+    }
+    for (size_t a = 0; a < rings.size(); a++) {
+        int depth = 0;
+        for (size_t b = 0; b < rings.size(); b++) {
+            bool box_inside = lo[a].x >= lo[b].x && lo[a].y >= lo[b].y && hi[a].x <= hi[b].x && hi[a].y <= hi[b].y;
+            if (a != b && box_inside && isRingInside(rings[a], rings[b])) {
+                depth++;
+            }
+        }
+        bool clockwise = signedArea(rings[a]) < 0.0;
+        if (clockwise != (depth % 2 == 1)) {
+            reverse(result[a].begin(), result[a].end());
+        }
+    }
+}
+
+}   // namespace
+
+vector<vector<vec2>> polygonBoolean(const vector<vec2>& subject_in, const vector<vec2>& clipper_in, BooleanOp op) {
+    if (subject_in.size() < 3 || clipper_in.size() < 3) {
+        // Union keeps whichever polygon is valid, difference only a valid subject
+        vector<vector<vec2>> result;
+        const vector<vec2>& valid = subject_in.size() >= 3 ? subject_in : clipper_in;
+        if (valid.size() >= 3 && (op == BOOLEAN_UNION || (op == BOOLEAN_DIFFERENCE && &valid == &subject_in))) {
+            result.push_back(valid);
+            normalizeWinding(result);
+        }
+        return result;
+    }
+
+    vector<Point> subject = toPoints(subject_in);
+    vector<Point> clipper = toPoints(clipper_in);
+
+    double extent = 0.0;
+    for (const Point& p : subject) {
+        extent = std::max(extent, std::max(fabs(p.x), fabs(p.y)));
+    }
+
+    // Degenerate crossings: nudge the clipper and search again
+    vector<Crossing> crossings;
+    unsigned int seed = 12345;
+    int attempt = 0;
+    while (!findCrossings(subject, clipper, &crossings)) {
+        if (++attempt > MAX_PERTURBATIONS) {
+            return vector<vector<vec2>>();
+        }
+        crossings.clear();
+        double amount = std::max(extent, 1.0) * 1e-7 * attempt;
+        for (Point& p : clipper) {
+            seed = seed * 1103515245 + 12345;
+            p.x += amount * ((seed >> 8) % 2001 / 1000.0 - 1.0);
+            seed = seed * 1103515245 + 12345;
+            p.y += amount * ((seed >> 8) % 2001 / 1000.0 - 1.0);
+        }
+    }
+
+    if (crossings.empty()) {
+        vector<vector<vec2>> result = nestedResult(subject, clipper, op);
+        normalizeWinding(result);
+        return result;
+    }
+
+    // Crossing nodes come first, subject and clipper copies are neighbors
+    vector<Node> nodes;
+    vector<vector<pair<double, int>>> subject_edges(subject.size());
+    vector<vector<pair<double, int>>> clipper_edges(clipper.size());
+    for (const Crossing& c : crossings) {
+        int s = (int)nodes.size();
+        int k = s + 1;
+        nodes.push_back(Node{ c.p, -1, -1, k, true, false, false });
+        nodes.push_back(Node{ c.p, -1, -1, s, true, false, false });
+        subject_edges[c.subject_edge].push_back(make_pair(c.subject_alpha, s));
+        clipper_edges[c.clipper_edge].push_back(make_pair(c.clipper_alpha, k));
+    }
+    int subject_head = buildList(subject, subject_edges, nodes);
+    int clipper_head = buildList(clipper, clipper_edges, nodes);
+
+    // Union walks both outsides, difference walks the subject outside and the clipper inside
+    markEntries(nodes, subject_head, clipper, op != BOOLEAN_INTERSECTION);
+    markEntries(nodes, clipper_head, subject, op == BOOLEAN_UNION);
+
+    vector<vector<vec2>> result;
+    for (size_t start = 0; start < crossings.size() * 2; start += 2) {
+        if (nodes[start].visited) {
+            continue;
+        }
+
+        vector<vec2> ring;
+        int cur = (int)start;
+        ring.push_back(vec2((float)nodes[cur].p.x, (float)nodes[cur].p.y));
+        do {
+            nodes[cur].visited = true;
+            nodes[nodes[cur].neighbor].visited = true;
+            bool forward = nodes[cur].entry;
+            do {
+                cur = forward ? nodes[cur].next : nodes[cur].prev;
+                ring.push_back(vec2((float)nodes[cur].p.x, (float)nodes[cur].p.y));
+            } while (!nodes[cur].is_intersection);
+            cur = nodes[cur].neighbor;
+        } while (!nodes[cur].visited);
+
+        // The walk ends on the starting crossing
+        ring.pop_back();
+        if (ring.size() >= 3) {
+            result.push_back(ring);
+        }
+    }
+    normalizeWinding(result);
+    return result;
+}
+
+size_t countCrossings(const vector<vec2>& subject, const vector<vec2>& clipper) {
+    vector<Crossing> crossings;
+    findCrossings(toPoints(subject), toPoints(clipper), &crossings);
+    return crossings.size();
+}
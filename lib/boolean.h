@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+enum BooleanOp { BOOLEAN_INTERSECTION, BOOLEAN_UNION, BOOLEAN_DIFFERENCE };
+
+/**
+ * Greiner-Hormann boolean of two simple or self-intersecting, convex or concave
+ * polygons (even-odd fill). Returns every output ring, whatever the input
+ * windings: outer rings counter clockwise, holes (rings inside another result
+ * ring) clockwise.
+ * Vertices lying exactly on the other polygon are handled by perturbing the clipper.
+ */
+std::vector<std::vector<glm::vec2>> polygonBoolean(const std::vector<glm::vec2>& subject, const std::vector<glm::vec2>& clipper, BooleanOp op);
+
+/** Number of subject/clipper edge crossings, found by the sweep */
+size_t countCrossings(const std::vector<glm::vec2>& subject, const std::vector<glm::vec2>& clipper);
@@ -0,0 +1,303 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+using namespace std;
+using namespace glm;
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes");
+
+// SAH cost of visiting a node, relative to one triangle test
+#define BVH_TRAVERSAL_COST 1.0f
+
+static float halfArea(vec3 lo, vec3 hi) {
+    vec3 d = glm::max(hi - lo, vec3(0.0f));
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+TriangleBVH::TriangleBVH() {
+    num_meshes = 0;
+    parallel_depth = 0;
+}
+
+void TriangleBVH::addMesh(const vector<vec3>& positions, const vector<unsigned int>& indices) {
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        vec3 p0 = positions[indices[i]];
+        vec3 p1 = positions[indices[i + 1]];
+        vec3 p2 = positions[indices[i + 2]];
+
+        triangles.push_back({ p0, p1, p2, num_meshes, (unsigned int)(i / 3) });
+        Bounds box = { glm::min(glm::min(p0, p1), p2), glm::max(glm::max(p0, p1), p2) };
+        bounds.push_back(box);
+        centroids.push_back((box.min + box.max) * 0.5f);
+    }
+    num_meshes++;
+}
+
+void TriangleBVH::clear() {
+    nodes.clear();
+    triangles.clear();
+    bounds.clear();
+    centroids.clear();
+    order.clear();
+    num_meshes = 0;
+}
+
+void TriangleBVH::build(int num_threads) {
+    nodes.clear();
+    if (triangles.empty()) {
+        return;
+    }
+
+    order.resize(triangles.size());
+    for (unsigned int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    // A few more subtrees than threads, so uneven splits still keep every core busy
+    parallel_depth = 1;
+    while ((1 << parallel_depth) < num_threads * 2) {
+        parallel_depth++;
+    }
+    if (num_threads <= 1) {
+        parallel_depth = 0;
+    }
+
+    nodes.reserve(triangles.size() * 2 / BVH_MAX_LEAF_SIZE + 1);
+    buildSubtree(0, (unsigned int)triangles.size(), 0, &nodes);
+
+    // Leaves index the triangles in tree order
+    vector<BvhTriangle> sorted(triangles.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = triangles[order[i]];
+    }
+    triangles.swap(sorted);
+
+    // Only triangles can be added after a build
+    vector<Bounds>().swap(bounds);
+    vector<vec3>().swap(centroids);
+    vector<unsigned int>().swap(order);
+}
+
+void TriangleBVH::buildSubtree(unsigned int first, unsigned int count, int depth, vector<BvhNode>* out) {
+    size_t index = out->size();
+    out->push_back(BvhNode());
+
+    vec3 lo(INFINITY), hi(-INFINITY), centroid_lo(INFINITY), centroid_hi(-INFINITY);
+    for (unsigned int i = first; i < first + count; i++) {
+        lo = glm::min(lo, bounds[order[i]].min);
+        hi = glm::max(hi, bounds[order[i]].max);
+        centroid_lo = glm::min(centroid_lo, centroids[order[i]]);
+        centroid_hi = glm::max(centroid_hi, centroids[order[i]]);
+    }
+    for (int k = 0; k < 3; k++) {
+        (*out)[index].min[k] = lo[k];
+        (*out)[index].max[k] = hi[k];
+    }
+
+    // (1) Binned SAH over the three axes
+    int best_axis = -1;
+    int best_bin = 0;
+    float best_cost = INFINITY;
+    vec3 extent = centroid_hi - centroid_lo;
+    if (count > 1 && depth < BVH_SAH_MAX_DEPTH) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0.0f) {
+                continue;
+            }
+            Bounds bins[BVH_BINS];
+            unsigned int bin_counts[BVH_BINS] = { 0 };
+            for (int b = 0; b < BVH_BINS; b++) {
+                bins[b] = { vec3(INFINITY), vec3(-INFINITY) };
+            }
+            float scale = BVH_BINS / extent[axis];
+            for (unsigned int i = first; i < first + count; i++) {
+                int b = std::min((int)((centroids[order[i]][axis] - centroid_lo[axis]) * scale), BVH_BINS - 1);
+                bins[b].min = glm::min(bins[b].min, bounds[order[i]].min);
+                bins[b].max = glm::max(bins[b].max, bounds[order[i]].max);
+                bin_counts[b]++;
+            }
+
+            // Right to left sweep first, then the split after bin b costs left[0..b] + right[b+1..]
+            float right_cost[BVH_BINS];
+            vec3 right_lo(INFINITY), right_hi(-INFINITY);
+            unsigned int right_count = 0;
+            for (int b = BVH_BINS - 1; b > 0; b--) {
+                right_lo = glm::min(right_lo, bins[b].min);
+                right_hi = glm::max(right_hi, bins[b].max);
+                right_count += bin_counts[b];
+                right_cost[b] = right_count * halfArea(right_lo, right_hi);
+            }
+            vec3 left_lo(INFINITY), left_hi(-INFINITY);
+            unsigned int left_count = 0;
+            for (int b = 0; b < BVH_BINS - 1; b++) {
+                left_lo = glm::min(left_lo, bins[b].min);
+                left_hi = glm::max(left_hi, bins[b].max);
+                left_count += bin_counts[b];
+                if (left_count == 0 || left_count == count) {
+                    continue;
+                }
+                float cost = left_count * halfArea(left_lo, left_hi) + right_cost[b + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+    }
+
+    float leaf_cost = count * halfArea(lo, hi);
+    best_cost = BVH_TRAVERSAL_COST * halfArea(lo, hi) + best_cost;
+    if (count <= BVH_MAX_LEAF_SIZE && (best_axis < 0 || best_cost >= leaf_cost)) {
+        (*out)[index].offset = first;
+        (*out)[index].count = (unsigned short)count;
+        (*out)[index].axis = 0;
+        return;
+    }
+
+    // (2) Partition, by SAH bin or at the object median (coincident centroids, deep trees)
+    unsigned int* begin = &order[first];
+    unsigned int* end = begin + count;
+    unsigned int left_count;
+    if (best_axis >= 0) {
+        float scale = BVH_BINS / extent[best_axis];
+        float origin = centroid_lo[best_axis];
+        const vector<vec3>& c = centroids;
+        int axis = best_axis, bin = best_bin;
+        left_count = (unsigned int)(std::partition(begin, end, [&](unsigned int t) {
+            return std::min((int)((c[t][axis] - origin) * scale), BVH_BINS - 1) <= bin;
+        }) - begin);
+    } else {
+        best_axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        left_count = count / 2;
+        const vector<vec3>& c = centroids;
+        int axis = best_axis;
+        std::nth_element(begin, begin + left_count, end, [&](unsigned int a, unsigned int b) { return c[a][axis] < c[b][axis]; });
+    }
+    (*out)[index].count = 0;
+    (*out)[index].axis = (unsigned short)best_axis;
+
+    // (3) Children, the left one right after its parent
+    unsigned int right_first = first + left_count;
+    unsigned int right_count = count - left_count;
+    if (depth < parallel_depth && count >= BVH_PARALLEL_MIN_TRIANGLES) {
+        // Subtrees are built apart with relative offsets, then appended
+        vector<BvhNode> left_nodes, right_nodes;
+        future<void> left = async(launch::async, [&]() { buildSubtree(first, left_count, depth + 1, &left_nodes); });
+        buildSubtree(right_first, right_count, depth + 1, &right_nodes);
+        left.get();
+
+        for (vector<BvhNode>* subtree : { &left_nodes, &right_nodes }) {
+            unsigned int base = (unsigned int)out->size();
+            if (subtree == &right_nodes) {
+                (*out)[index].offset = base;
+            }
+            for (BvhNode node : *subtree) {
+                node.offset += node.count == 0 ? base : 0;
+                out->push_back(node);
+            }
+        }
+    } else {
+        buildSubtree(first, left_count, depth + 1, out);
+        (*out)[index].offset = (unsigned int)out->size();
+        buildSubtree(right_first, right_count, depth + 1, out);
+    }
+}
+
+// Slab test, entry distance in t_near
+static inline bool intersectBox(const BvhNode& node, vec3 origin, vec3 inv_dir, float t_min, float t_max, float* t_near) {
+    float t0 = t_min, t1 = t_max;
+    for (int k = 0; k < 3; k++) {
+        float a = (node.min[k] - origin[k]) * inv_dir[k];
+        float b = (node.max[k] - origin[k]) * inv_dir[k];
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    *t_near = t0;
+    return t0 <= t1;
+}
+
+bool TriangleBVH::traverse(const Ray& ray, bool any_hit, RayHit* hit) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    vec3 inv_dir = 1.0f / ray.direction;
+    WatertightRay watertight = setupRay(ray.origin, ray.direction);
+    float t_max = ray.t_max;
+    float t_near;
+    if (!intersectBox(nodes[0], ray.origin, inv_dir, ray.t_min, t_max, &t_near)) {
+        return false;
+    }
+
+    // Far children waiting, with their entry distance
+    unsigned int stack[BVH_STACK_SIZE];
+    float stack_t[BVH_STACK_SIZE];
+    int stack_size = 0;
+
+    bool found = false;
+    unsigned int index = 0;
+    while (true) {
+        const BvhNode& node = nodes[index];
+        if (node.count > 0) {
+            for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+                const BvhTriangle& triangle = triangles[i];
+                TriangleHit triangle_hit;
+                if (!intersectTriangle(watertight, triangle.v0, triangle.v1, triangle.v2, ray.t_min, t_max, &triangle_hit)) {
+                    continue;
+                }
+                if (any_hit) {
+                    return true;
+                }
+                t_max = triangle_hit.t;
+                hit->t = triangle_hit.t;
+                hit->u = triangle_hit.u;
+                hit->v = triangle_hit.v;
+                hit->mesh = triangle.mesh;
+                hit->triangle = triangle.index;
+                found = true;
+            }
+        } else {
+            unsigned int left = index + 1;
+            unsigned int right = node.offset;
+            float t_left, t_right;
+            bool hit_left = intersectBox(nodes[left], ray.origin, inv_dir, ray.t_min, t_max, &t_left);
+            bool hit_right = intersectBox(nodes[right], ray.origin, inv_dir, ray.t_min, t_max, &t_right);
+            if (hit_left && hit_right) {
+                bool left_first = t_left <= t_right;
+                stack[stack_size] = left_first ? right : left;
+                stack_t[stack_size] = left_first ? t_right : t_left;
+                stack_size++;
+                index = left_first ? left : right;
+                continue;
+            }
+            if (hit_left || hit_right) {
+                index = hit_left ? left : right;
+                continue;
+            }
+        }
+
+        // Next far child still in front of the closest hit
+        do {
+            if (stack_size == 0) {
+                return found;
+            }
+            stack_size--;
+        } while (stack_t[stack_size] > t_max);
+        index = stack[stack_size];
+    }
+}
+
+bool TriangleBVH::intersect(const Ray& ray, RayHit* hit) const {
+    return traverse(ray, false, hit);
+}
+
+bool TriangleBVH::occluded(const Ray& ray) const {
+    return traverse(ray, true, nullptr);
+}
+
+size_t TriangleBVH::getNumNodes() const { return nodes.size(); }
+size_t TriangleBVH::getNumTriangles() const { return triangles.size(); }
+const vector<BvhNode>& TriangleBVH::getNodes() const { return nodes; }
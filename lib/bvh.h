@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "raytri.h"
+
+// SAH bins per axis
+#define BVH_BINS 16
+
+// Largest leaf the SAH may choose
+#define BVH_MAX_LEAF_SIZE 4
+
+// Below this depth splits fall back to the object median, bounding the traversal stack
+#define BVH_SAH_MAX_DEPTH 32
+#define BVH_STACK_SIZE 64
+
+// Subtrees with fewer triangles are built by the thread that reached them
+#define BVH_PARALLEL_MIN_TRIANGLES 4096
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float t_min;
+    float t_max;
+};
+
+/** Closest hit: distance along the ray, barycentrics of vertices 1 and 2, mesh and triangle (in mesh order) */
+struct RayHit {
+    float t;
+    float u;
+    float v;
+    unsigned int mesh;
+    unsigned int triangle;
+};
+
+/**
+ * 32 bytes, nodes in depth-first order: the left child follows its parent.
+ * Inner nodes keep the index of their right child in offset and count 0,
+ * leaves keep their first triangle and triangle count.
+ */
+struct alignas(32) BvhNode {
+    float min[3];
+    unsigned int offset;
+    float max[3];
+    unsigned short count;
+    unsigned short axis;
+};
+
+/** Triangles are stored in leaf order, tested with the watertight kernel */
+struct BvhTriangle {
+    glm::vec3 v0;
+    glm::vec3 v1;
+    glm::vec3 v2;
+    unsigned int mesh;
+    unsigned int index;
+};
+
+/**
+ * Bounding volume hierarchy over the triangles of several meshes, built with
+ * a binned SAH (subtrees in parallel) and traversed with a short stack,
+ * nearest child first.
+ */
+class TriangleBVH {
+   public:
+    TriangleBVH();
+
+    /** Indexed triangles of one mesh, meshes are numbered in call order */
+    void addMesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+    void build(int num_threads);
+    void clear();
+
+    /** Closest hit in (t_min, t_max), both faces */
+    bool intersect(const Ray& ray, RayHit* hit) const;
+
+    /** Any hit in (t_min, t_max), for shadow and visibility rays */
+    bool occluded(const Ray& ray) const;
+
+    size_t getNumNodes() const;
+    size_t getNumTriangles() const;
+    const std::vector<BvhNode>& getNodes() const;
+
+   private:
+    struct Bounds {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    std::vector<BvhNode> nodes;
+    std::vector<BvhTriangle> triangles;
+    unsigned int num_meshes;
+
+    // Build inputs, released after build
+    std::vector<Bounds> bounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<unsigned int> order;
+    int parallel_depth;
+
+    void buildSubtree(unsigned int first, unsigned int count, int depth, std::vector<BvhNode>* out);
+    bool traverse(const Ray& ray, bool any_hit, RayHit* hit) const;
+};
@@ -0,0 +1,140 @@
+#include "clipping.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+using namespace glm;
+
+// Fewer polygons than this per thread are clipped on the calling thread
+#define MIN_POLYGONS_PER_THREAD 1024
+
+size_t PolygonList::size() const {
+    return offsets.size() - 1;
+}
+
+void PolygonList::add(const vec2* poly, size_t n) {
+    vertices.insert(vertices.end(), poly, poly + n);
+    offsets.push_back((unsigned int)vertices.size());
+}
+
+void PolygonList::clear() {
+    vertices.clear();
+    offsets.assign(1, 0);
+}
+
+PolygonClipper::PolygonClipper(const vector<vec2>& clipper) {
+    for (size_t i = 0; i < clipper.size(); i++) {
+        vec2 e_p1 = clipper[i];
+        vec2 e_p2 = clipper[(i + 1) % clipper.size()];
+
+        // Same side test as leftOn(e_p1, e_p2, p)
+        vec2 normal(-(e_p2.y - e_p1.y), e_p2.x - e_p1.x);
+        edges.push_back(Edge{ normal, -dot(normal, e_p1) });
+    }
+}
+
+vector<vec2> PolygonClipper::clip(const vector<vec2>& poly) {
+    const vec2* result;
+    size_t size = clipPolygon(poly.data(), poly.size(), ping, pong, &result);
+    return vector<vec2>(result, result + size);
+}
+
+size_t PolygonClipper::clipPolygon(const vec2* poly, size_t n, vector<vec2>& ping, vector<vec2>& pong, const vec2** result) const {
+    const vec2* in = poly;
+    size_t in_size = n;
+    vector<vec2>* out = &ping;
+    vector<vec2>* other = &pong;
+
+    for (const Edge& edge : edges) {
+        if (in_size == 0) {
+            break;
+        }
+
+        // Buffers only grow. A concave input crosses the edge up to in_size times,
+        // each re-entry adds one vertex
+        size_t capacity = in_size + in_size / 2 + 1;
+        if (out->size() < capacity) {
+            out->resize(capacity);
+        }
+        vec2* dst = out->data();
+        size_t out_size = 0;
+
+        vec2 p1 = in[in_size - 1];
+        float d1 = dot(edge.normal, p1) + edge.offset;
+        for (size_t i = 0; i < in_size; i++) {
+            vec2 p2 = in[i];
+            float d2 = dot(edge.normal, p2) + edge.offset;
+
+            if ((d1 >= 0.0f) != (d2 >= 0.0f)) {
+                dst[out_size++] = p1 + (p2 - p1) * (d1 / (d1 - d2));
+            }
+            if (d2 >= 0.0f) {
+                dst[out_size++] = p2;
+            }
+
+            p1 = p2;
+            d1 = d2;
+        }
+
+        in = dst;
+        in_size = out_size;
+        swap(out, other);
+    }
+
+    // Points to the last written buffer, or to the input when there are no edges
+    *result = in;
+    return in_size;
+}
+
+void PolygonClipper::clipRange(const PolygonList& polys, size_t first, size_t last, PolygonList* out) const {
+    vector<vec2> thread_ping, thread_pong;
+    for (size_t i = first; i < last; i++) {
+        unsigned int begin = polys.offsets[i];
+        unsigned int end = polys.offsets[i + 1];
+        const vec2* clipped;
+        size_t size = clipPolygon(polys.vertices.data() + begin, end - begin, thread_ping, thread_pong, &clipped);
+        out->add(clipped, size);
+    }
+}
+
+PolygonList PolygonClipper::clipBatch(const PolygonList& polys, int num_threads) const {
+    size_t count = polys.size();
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, thread::hardware_concurrency());
+    }
+    num_threads = (int)std::max<size_t>(1, std::min<size_t>(num_threads, count / MIN_POLYGONS_PER_THREAD));
+
+    PolygonList result;
+    if (num_threads == 1) {
+        clipRange(polys, 0, count, &result);
+        return result;
+    }
+
+    // Each thread fills its own list, concatenated in order afterwards
+    vector<PolygonList> partial(num_threads);
+    vector<thread> threads;
+    size_t chunk = (count + num_threads - 1) / num_threads;
+    for (int t = 0; t < num_threads; t++) {
+        size_t first = std::min(count, t * chunk);
+        size_t last = std::min(count, first + chunk);
+        threads.emplace_back(&PolygonClipper::clipRange, this, cref(polys), first, last, &partial[t]);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    size_t num_vertices = 0;
+    for (const PolygonList& p : partial) {
+        num_vertices += p.vertices.size();
+    }
+    result.vertices.reserve(num_vertices);
+    result.offsets.reserve(count + 1);
+    for (const PolygonList& p : partial) {
+        unsigned int base = (unsigned int)result.vertices.size();
+        result.vertices.insert(result.vertices.end(), p.vertices.begin(), p.vertices.end());
+        for (size_t i = 1; i < p.offsets.size(); i++) {
+            result.offsets.push_back(base + p.offsets[i]);
+        }
+    }
+    return result;
+}
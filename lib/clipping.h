@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+/** Polygons stored back to back: polygon i is vertices[offsets[i]] up to vertices[offsets[i + 1]] */
+struct PolygonList {
+    std::vector<glm::vec2> vertices;
+    std::vector<unsigned int> offsets{ 0 };
+
+    size_t size() const;
+    void add(const glm::vec2* poly, size_t n);
+    void clear();
+};
+
+/**
+ * Sutherland-Hodgman clipping against a fixed convex clipper (counter clockwise).
+ * Clip edges are precomputed as lines, vertices move between two scratch buffers.
+ */
+class PolygonClipper {
+   public:
+    PolygonClipper(const std::vector<glm::vec2>& clipper);
+
+    /** Single polygon, reuses the clipper scratch buffers (one thread per clipper) */
+    std::vector<glm::vec2> clip(const std::vector<glm::vec2>& poly);
+
+    /** Many polygons split across threads (0: one per core), same order as the input */
+    PolygonList clipBatch(const PolygonList& polys, int num_threads = 0) const;
+
+   private:
+    // Edge line: inside when normal . p + offset >= 0
+    struct Edge {
+        glm::vec2 normal;
+        float offset;
+    };
+    std::vector<Edge> edges;
+
+    std::vector<glm::vec2> ping;
+    std::vector<glm::vec2> pong;
+
+    size_t clipPolygon(const glm::vec2* poly, size_t n, std::vector<glm::vec2>& ping, std::vector<glm::vec2>& pong, const glm::vec2** result) const;
+    void clipRange(const PolygonList& polys, size_t first, size_t last, PolygonList* out) const;
+};
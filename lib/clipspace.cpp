@@ -0,0 +1,151 @@
+#include "clipspace.h"
+#include <algorithm>
+
+using namespace std;
+using namespace glm;
+
+// Clipping planes: guard band left, right, bottom, top, then near and far
+#define NUM_CLIP_PLANES 6
+
+TriangleClipper::TriangleClipper(float guard_band) {
+    this->guard_band = std::max(guard_band, 1.0f);
+}
+
+unsigned int TriangleClipper::outcode(vec4 p) const {
+    float guard_w = guard_band * p.w;
+    unsigned int code = 0;
+    code |= (p.x < -p.w) ? CLIP_LEFT : 0;
+    code |= (p.x > p.w) ? CLIP_RIGHT : 0;
+    code |= (p.y < -p.w) ? CLIP_BOTTOM : 0;
+    code |= (p.y > p.w) ? CLIP_TOP : 0;
+    code |= (p.z < -p.w) ? CLIP_NEAR : 0;
+    code |= (p.z > p.w) ? CLIP_FAR : 0;
+    code |= (p.x < -guard_w) ? CLIP_GUARD_LEFT : 0;
+    code |= (p.x > guard_w) ? CLIP_GUARD_RIGHT : 0;
+    code |= (p.y < -guard_w) ? CLIP_GUARD_BOTTOM : 0;
+    code |= (p.y > guard_w) ? CLIP_GUARD_TOP : 0;
+    return code;
+}
+
+void TriangleClipper::outcodes(const float* x, const float* y, const float* z, const float* w, size_t n, unsigned int* codes) const {
+    // Branch free, same bits as outcode()
+    for (size_t i = 0; i < n; i++) {
+        float guard_w = guard_band * w[i];
+        codes[i] = (unsigned int)(x[i] < -w[i]) * CLIP_LEFT | (unsigned int)(x[i] > w[i]) * CLIP_RIGHT | (unsigned int)(y[i] < -w[i]) * CLIP_BOTTOM | (unsigned int)(y[i] > w[i]) * CLIP_TOP |
+                   (unsigned int)(z[i] < -w[i]) * CLIP_NEAR | (unsigned int)(z[i] > w[i]) * CLIP_FAR | (unsigned int)(x[i] < -guard_w) * CLIP_GUARD_LEFT |
+                   (unsigned int)(x[i] > guard_w) * CLIP_GUARD_RIGHT | (unsigned int)(y[i] < -guard_w) * CLIP_GUARD_BOTTOM | (unsigned int)(y[i] > guard_w) * CLIP_GUARD_TOP;
+    }
+}
+
+ClipResult TriangleClipper::classify(unsigned int code0, unsigned int code1, unsigned int code2) const {
+    // All vertices outside the same viewport plane
+    if (code0 & code1 & code2 & CLIP_VIEW_MASK) {
+        return CLIP_REJECTED;
+    }
+    // Only the guard band and near/far need actual clipping
+    if (((code0 | code1 | code2) & ~(CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP)) == 0) {
+        return CLIP_ACCEPTED;
+    }
+    return CLIP_CLIPPED;
+}
+
+float TriangleClipper::planeDistance(int plane, vec4 p) const {
+    switch (plane) {
+        case 0:
+            return p.x + guard_band * p.w;
+        case 1:
+            return guard_band * p.w - p.x;
+        case 2:
+            return p.y + guard_band * p.w;
+        case 3:
+            return guard_band * p.w - p.y;
+        case 4:
+            return p.z + p.w;
+        default:
+            return p.w - p.z;
+    }
+}
+
+void TriangleClipper::lerpVertex(const ClipVertex& a, const ClipVertex& b, float t, int num_attributes, ClipVertex* out) {
+    // Linear in clip space, which is perspective correct once divided by w
+    out->position = a.position + (b.position - a.position) * t;
+    for (int i = 0; i < num_attributes; i++) {
+        out->attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+    }
+}
+
+ClipResult TriangleClipper::clip(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int num_attributes, ClipPolygon* out) const {
+    unsigned int code0 = outcode(v0.position);
+    unsigned int code1 = outcode(v1.position);
+    unsigned int code2 = outcode(v2.position);
+
+    ClipResult result = classify(code0, code1, code2);
+    if (result == CLIP_REJECTED) {
+        out->size = 0;
+        return result;
+    }
+
+    out->vertices[0] = v0;
+    out->vertices[1] = v1;
+    out->vertices[2] = v2;
+    out->size = 3;
+    if (result == CLIP_ACCEPTED) {
+        return result;
+    }
+
+    // Only the planes crossed by some vertex, guard band bits map to planes 0-3
+    unsigned int crossed = code0 | code1 | code2;
+    unsigned int plane_mask = ((crossed >> 6) & 0xF) | (crossed & (CLIP_NEAR | CLIP_FAR));
+
+    ClipPolygon scratch;
+    ClipPolygon* in = out;
+    ClipPolygon* dst = &scratch;
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        if (!(plane_mask & (1 << plane))) {
+            continue;
+        }
+
+        dst->size = 0;
+        const ClipVertex* prev = &in->vertices[in->size - 1];
+        float d_prev = planeDistance(plane, prev->position);
+        for (int i = 0; i < in->size; i++) {
+            const ClipVertex* cur = &in->vertices[i];
+            float d_cur = planeDistance(plane, cur->position);
+
+            if ((d_prev >= 0.0f) != (d_cur >= 0.0f)) {
+                lerpVertex(*prev, *cur, d_prev / (d_prev - d_cur), num_attributes, &dst->vertices[dst->size++]);
+            }
+            if (d_cur >= 0.0f) {
+                dst->vertices[dst->size++] = *cur;
+            }
+
+            prev = cur;
+            d_prev = d_cur;
+        }
+
+        swap(in, dst);
+        if (in->size < 3) {
+            out->size = 0;
+            return CLIP_REJECTED;
+        }
+    }
+
+    if (in != out) {
+        out->size = in->size;
+        copy(in->vertices, in->vertices + in->size, out->vertices);
+    }
+    return CLIP_CLIPPED;
+}
+
+bool TriangleClipper::isBoxVisible(const mat4& model_view_projection, vec3 box_min, vec3 box_max) const {
+    // Culled only when all 8 corners are outside the same plane (conservative)
+    unsigned int all = CLIP_VIEW_MASK;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner((i & 1) ? box_max.x : box_min.x, (i & 2) ? box_max.y : box_min.y, (i & 4) ? box_max.z : box_min.z);
+        all &= outcode(model_view_projection * vec4(corner, 1.0f));
+        if (all == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Floats interpolated along with the position (normals, uvs, colors...)
+#define CLIP_MAX_ATTRIBUTES 12
+
+// A triangle clipped by the 6 frustum planes has at most 3 + 6 vertices
+#define CLIP_MAX_VERTICES 9
+
+// Outcode bits: viewport planes, then guard band planes for x and y
+#define CLIP_LEFT 0x01
+#define CLIP_RIGHT 0x02
+#define CLIP_BOTTOM 0x04
+#define CLIP_TOP 0x08
+#define CLIP_NEAR 0x10
+#define CLIP_FAR 0x20
+#define CLIP_GUARD_LEFT 0x40
+#define CLIP_GUARD_RIGHT 0x80
+#define CLIP_GUARD_BOTTOM 0x100
+#define CLIP_GUARD_TOP 0x200
+
+#define CLIP_VIEW_MASK 0x3F
+
+/** Clip space vertex (OpenGL convention: -w <= x, y, z <= w) */
+struct ClipVertex {
+    glm::vec4 position;
+    float attributes[CLIP_MAX_ATTRIBUTES];
+};
+
+/** Fixed capacity output, a convex polygon to be drawn as a fan */
+struct ClipPolygon {
+    ClipVertex vertices[CLIP_MAX_VERTICES];
+    int size;
+};
+
+enum ClipResult { CLIP_REJECTED, CLIP_ACCEPTED, CLIP_CLIPPED };
+
+/**
+ * Triangle clipper for a software pipeline.
+ * Triangles inside the guard band but crossing the viewport are accepted
+ * unclipped (the rasterizer scissors them), only near/far and the guard
+ * band planes generate new vertices.
+ */
+class TriangleClipper {
+   public:
+    /** guard_band: x and y limits as multiples of w (1 disables the guard band) */
+    TriangleClipper(float guard_band = 1.0f);
+
+    unsigned int outcode(glm::vec4 p) const;
+
+    /** Vectorizable outcodes over structure of arrays clip positions */
+    void outcodes(const float* x, const float* y, const float* z, const float* w, size_t n, unsigned int* codes) const;
+
+    ClipResult classify(unsigned int code0, unsigned int code1, unsigned int code2) const;
+
+    /** Clips one triangle, out->size is 0 when it is rejected */
+    ClipResult clip(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int num_attributes, ClipPolygon* out) const;
+
+    /** Box in object space against the frustum of model_view_projection, for culling */
+    bool isBoxVisible(const glm::mat4& model_view_projection, glm::vec3 box_min, glm::vec3 box_max) const;
+
+   private:
+    float guard_band;
+
+    float planeDistance(int plane, glm::vec4 p) const;
+    static void lerpVertex(const ClipVertex& a, const ClipVertex& b, float t, int num_attributes, ClipVertex* out);
+};
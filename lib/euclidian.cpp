@@ -1,24 +1,24 @@
 #include "euclidian.h"
+#include "clipping.h"
 #include <numeric>
 #include <cmath>
-#include <iostream>
-#include <glm/gtx/string_cast.hpp>
 
 using namespace std;
 using namespace glm;
 
-float innerProduct(vector<float> v1, vector<float> v2) {
+float innerProduct(const vector<float>& v1, const vector<float>& v2) {
+    if (v1.size() == 3 && v2.size() == 3) {
+        return innerProduct(vec3(v1[0], v1[1], v1[2]), vec3(v2[0], v2[1], v2[2]));
+    }
     return inner_product(v1.begin(), v1.end(), v2.begin(), 0.0f);
 }
 
-vector<float> crossProduct(vector<float> v1, vector<float> v2) {
-    float p0 = v1[1] * v2[2] - v1[2] * v2[1];
-    float p1 = -(v1[0] * v2[2] - v1[2] * v2[0]);
-    float p2 = v1[0] * v2[1] - v1[1] * v2[0];
-    return vector<float>{ p0, p1, p2 };
+vector<float> crossProduct(const vector<float>& v1, const vector<float>& v2) {
+    vec3 p = crossProduct(vec3(v1[0], v1[1], v1[2]), vec3(v2[0], v2[1], v2[2]));
+    return vector<float>{ p.x, p.y, p.z };
 }
 
-float innerAngle(vector<float> v1, vector<float> v2) {
+float innerAngle(const vector<float>& v1, const vector<float>& v2) {
     float inner = innerProduct(v1, v2);
     float len_sq_v1 = lenSquared(v1);
     float len_sq_v2 = lenSquared(v2);
@@ -30,7 +30,7 @@ float innerAngle(vector<float> v1, vector<float> v2) {
     return acos(inner / sqrt(len_sq_v1 * len_sq_v2));
 }
 
-float lenSquared(vector<float> v) {
+float lenSquared(const vector<float>& v) {
     float len_sq = 0.0f;
     for (float e : v) {
         len_sq += e * e;
@@ -38,7 +38,7 @@ float lenSquared(vector<float> v) {
     return len_sq;
 }
 
-float length(vector<float> v) {
+float length(const vector<float>& v) {
     return sqrt(lenSquared(v));
 }
 
@@ -47,11 +47,91 @@ float rad2dgr(float radian) {
     return radian * (180 / pi);
 }
 
-// font: https://en.wikipedia.org/wiki/Distance_from_a_point_to_a_line
-float distPoint2Line(vector<float> p, vector<float> line_point, vector<float> line_vector) {
-    vector<float> ap{ p[0] - line_point[0], p[1] - line_point[1], p[2] - line_point[2] };
-    float dist = sqrt(lenSquared(crossProduct(ap, line_vector)) / lenSquared(line_vector));
-    return dist;
+float distPoint2Line(const vector<float>& p, const vector<float>& line_point, const vector<float>& line_vector) {
+    return distPoint2Line(vec3(p[0], p[1], p[2]), vec3(line_point[0], line_point[1], line_point[2]), vec3(line_vector[0], line_vector[1], line_vector[2]));
+}
+
+// Plain loops over restrict pointers, vectorized by the compiler
+void innerProductBatch(const Vec3Span& a, const Vec3Span& b, float* out) {
+    const float* __restrict ax = a.x;
+    const float* __restrict ay = a.y;
+    const float* __restrict az = a.z;
+    const float* __restrict bx = b.x;
+    const float* __restrict by = b.y;
+    const float* __restrict bz = b.z;
+    float* __restrict o = out;
+    for (size_t i = 0; i < a.size; i++) {
+        o[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+    }
+}
+
+void crossProductBatch(const Vec3Span& a, const Vec3Span& b, const Vec3Span& out) {
+    const float* __restrict ax = a.x;
+    const float* __restrict ay = a.y;
+    const float* __restrict az = a.z;
+    const float* __restrict bx = b.x;
+    const float* __restrict by = b.y;
+    const float* __restrict bz = b.z;
+    float* __restrict ox = out.x;
+    float* __restrict oy = out.y;
+    float* __restrict oz = out.z;
+    for (size_t i = 0; i < a.size; i++) {
+        ox[i] = ay[i] * bz[i] - az[i] * by[i];
+        oy[i] = az[i] * bx[i] - ax[i] * bz[i];
+        oz[i] = ax[i] * by[i] - ay[i] * bx[i];
+    }
+}
+
+void innerAngleBatch(const Vec3Span& a, const Vec3Span& b, float* out) {
+    const float* __restrict ax = a.x;
+    const float* __restrict ay = a.y;
+    const float* __restrict az = a.z;
+    const float* __restrict bx = b.x;
+    const float* __restrict by = b.y;
+    const float* __restrict bz = b.z;
+    float* __restrict o = out;
+    for (size_t i = 0; i < a.size; i++) {
+        float inner = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+        float len_sq = (ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i]) * (bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i]);
+        o[i] = len_sq == 0 ? 0.0f : acosf(inner / sqrtf(len_sq));
+    }
+}
+
+void lenSquaredBatch(const Vec3Span& v, float* out) {
+    const float* __restrict x = v.x;
+    const float* __restrict y = v.y;
+    const float* __restrict z = v.z;
+    float* __restrict o = out;
+    for (size_t i = 0; i < v.size; i++) {
+        o[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+    }
+}
+
+void lengthBatch(const Vec3Span& v, float* out) {
+    const float* __restrict x = v.x;
+    const float* __restrict y = v.y;
+    const float* __restrict z = v.z;
+    float* __restrict o = out;
+    for (size_t i = 0; i < v.size; i++) {
+        o[i] = sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+    }
+}
+
+void distPoint2LineBatch(const Vec3Span& p, vec3 line_point, vec3 line_vector, float* out) {
+    const float* __restrict px = p.x;
+    const float* __restrict py = p.y;
+    const float* __restrict pz = p.z;
+    float* __restrict o = out;
+    float inv_len_sq = 1.0f / lenSquared(line_vector);
+    for (size_t i = 0; i < p.size; i++) {
+        float ax = px[i] - line_point.x;
+        float ay = py[i] - line_point.y;
+        float az = pz[i] - line_point.z;
+        float cx = ay * line_vector.z - az * line_vector.y;
+        float cy = az * line_vector.x - ax * line_vector.z;
+        float cz = ax * line_vector.y - ay * line_vector.x;
+        o[i] = sqrtf((cx * cx + cy * cy + cz * cz) * inv_len_sq);
+    }
 }
 
 vector<vec2> to2DVector(float* in, int size) {
@@ -74,67 +154,9 @@ void to3DPointer(vector<vec2> v, float* out, int* size, float z) {
     *size = v.size();
 }
 
-vec2 intersect(vec2 p1, vec2 p2, vec2 p3, vec2 p4) {
-    float num_x = (p1.x * p2.y - p1.y * p2.x) * (p3.x - p4.x) - (p1.x - p2.x) * (p3.x * p4.y - p3.y * p4.x);
-    float num_y = (p1.x * p2.y - p1.y * p2.x) * (p3.y - p4.y) - (p1.y - p2.y) * (p3.x * p4.y - p3.y * p4.x);
-    float den = (p1.x - p2.x) * (p3.y - p4.y) - (p1.y - p2.y) * (p3.x - p4.x);
-    return vec2(num_x / den, num_y / den);
-}
-
-float paralelogram_area(vec2 p1, vec2 p2, vec2 p3) {
-    return (p2.x - p1.x) * (p3.y - p1.y) - (p2.y - p1.y) * (p3.x - p1.x);
-}
-
-bool leftOn(vec2 p1, vec2 p2, vec2 p3) {
-    return paralelogram_area(p1, p2, p3) >= 0.0f;
-}
-
-void clip(vector<vec2>* poly, vec2 e_p1, vec2 e_p2) {
-    vector<vec2> clipped;
-
-    for (int i = 0; i < poly->size(); i++) {
-        int k = (i + 1) % poly->size();
-        cout << "poly i: " << i << ", k: " << k << endl;
-
-        vec2 p1 = poly->at(i);
-        vec2 p2 = poly->at(k);
-
-        bool p1_in = leftOn(e_p1, e_p2, p1);
-        bool p2_in = leftOn(e_p1, e_p2, p2);
-
-        if (p1_in) {
-            clipped.push_back(p1);
-            cout << "added p1: " << to_string(p1) << endl;
-
-            if (!p2_in) {
-                vec2 intersection = intersect(p1, p2, e_p1, e_p2);
-                clipped.push_back(intersection);
-                cout << "added intersection: " << to_string(intersection) << endl;
-            }
-        } else {
-            if (p2_in) {
-                vec2 intersection = intersect(p1, p2, e_p1, e_p2);
-                clipped.push_back(intersection);
-                cout << "added intersection: " << to_string(intersection) << endl;
-            }
-        }
-    }
-    *poly = clipped;
-}
-
-vector<vec2> suthHodgClip(vector<vec2> poly, vector<vec2> clipper) {
-    vector<vec2> clipped(poly.begin(), poly.end());
-
-    for (int i = 0; i < clipper.size(); i++) {
-        int k = (i + 1) % clipper.size();
-        cout << "clipper i: " << i << ", k: " << k << endl;
-        vec2 edge_p1 = clipper[i];
-        vec2 edge_p2 = clipper[k];
-
-        clip(&clipped, edge_p1, edge_p2);
-    }
-
-    return clipped;
+vector<vec2> suthHodgClip(const vector<vec2>& poly, const vector<vec2>& clipper) {
+    PolygonClipper engine(clipper);
+    return engine.clip(poly);
 }
 
 // https://www.geeksforgeeks.org/mid-point-circle-drawing-algorithm/
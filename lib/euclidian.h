@@ -1,25 +1,110 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <vector>
 #include <glm/glm.hpp>
 
-float innerProduct(std::vector<float> v1, std::vector<float> v2);
+// Dynamic size vectors, kept for compatibility (3D functions forward to the glm versions)
+float innerProduct(const std::vector<float>& v1, const std::vector<float>& v2);
 
-std::vector<float> crossProduct(std::vector<float> v1, std::vector<float> v2);
+std::vector<float> crossProduct(const std::vector<float>& v1, const std::vector<float>& v2);
 
-float innerAngle(std::vector<float> v1, std::vector<float> v2);
+float innerAngle(const std::vector<float>& v1, const std::vector<float>& v2);
 
-float lenSquared(std::vector<float> v);
+float lenSquared(const std::vector<float>& v);
 
-float length(std::vector<float> v) ;
+float length(const std::vector<float>& v);
 
 float rad2dgr(float angle);
 
-float distPoint2Line(std::vector<float> p, std::vector<float> line_point, std::vector<float> line_vector);
+float distPoint2Line(const std::vector<float>& p, const std::vector<float>& line_point, const std::vector<float>& line_vector);
+
+// Fixed size 3D vectors, inlined and allocation free
+inline float innerProduct(glm::vec3 v1, glm::vec3 v2) {
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+inline glm::vec3 crossProduct(glm::vec3 v1, glm::vec3 v2) {
+    return glm::vec3(v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x);
+}
+
+inline float lenSquared(glm::vec3 v) {
+    return innerProduct(v, v);
+}
+
+inline float length(glm::vec3 v) {
+    return std::sqrt(lenSquared(v));
+}
+
+inline float innerAngle(glm::vec3 v1, glm::vec3 v2) {
+    float len_sq = lenSquared(v1) * lenSquared(v2);
+    if (len_sq == 0) {
+        return 0.0f;
+    }
+    return std::acos(innerProduct(v1, v2) / std::sqrt(len_sq));
+}
+
+// font: https://en.wikipedia.org/wiki/Distance_from_a_point_to_a_line
+inline float distPoint2Line(glm::vec3 p, glm::vec3 line_point, glm::vec3 line_vector) {
+    return std::sqrt(lenSquared(crossProduct(p - line_point, line_vector)) / lenSquared(line_vector));
+}
+
+inline glm::vec3 toVec3(const std::array<float, 3>& a) {
+    return glm::vec3(a[0], a[1], a[2]);
+}
+
+inline float innerProduct(const std::array<float, 3>& v1, const std::array<float, 3>& v2) {
+    return innerProduct(toVec3(v1), toVec3(v2));
+}
+
+inline std::array<float, 3> crossProduct(const std::array<float, 3>& v1, const std::array<float, 3>& v2) {
+    glm::vec3 p = crossProduct(toVec3(v1), toVec3(v2));
+    return std::array<float, 3>{ p.x, p.y, p.z };
+}
+
+inline float innerAngle(const std::array<float, 3>& v1, const std::array<float, 3>& v2) {
+    return innerAngle(toVec3(v1), toVec3(v2));
+}
+
+inline float lenSquared(const std::array<float, 3>& v) {
+    return lenSquared(toVec3(v));
+}
+
+inline float length(const std::array<float, 3>& v) {
+    return length(toVec3(v));
+}
+
+inline float distPoint2Line(const std::array<float, 3>& p, const std::array<float, 3>& line_point, const std::array<float, 3>& line_vector) {
+    return distPoint2Line(toVec3(p), toVec3(line_point), toVec3(line_vector));
+}
+
+// Structure of arrays view over `size` 3D vectors
+struct Vec3Span {
+    float* x;
+    float* y;
+    float* z;
+    size_t size;
+};
+
+// Batch variants, element i of each span is one vector (out has a.size elements)
+void innerProductBatch(const Vec3Span& a, const Vec3Span& b, float* out);
+
+void crossProductBatch(const Vec3Span& a, const Vec3Span& b, const Vec3Span& out);
+
+void innerAngleBatch(const Vec3Span& a, const Vec3Span& b, float* out);
+
+void lenSquaredBatch(const Vec3Span& v, float* out);
+
+void lengthBatch(const Vec3Span& v, float* out);
+
+void distPoint2LineBatch(const Vec3Span& p, glm::vec3 line_point, glm::vec3 line_vector, float* out);
 
 std::vector<glm::vec2> to2DVector(float* in, int size);
 void to3DPointer(std::vector<glm::vec2> v, float* out, int* size, float z);
 
-std::vector<glm::vec2> suthHodgClip(std::vector<glm::vec2> poly, std::vector<glm::vec2> clipper);
+// Clipper must be convex and counter clockwise, see PolygonClipper (clipping.h) for repeated and batch clipping
+std::vector<glm::vec2> suthHodgClip(const std::vector<glm::vec2>& poly, const std::vector<glm::vec2>& clipper);
 
 std::vector<glm::ivec2> midPointCircleDraw(glm::ivec2 c, int r);
@@ -0,0 +1,228 @@
+#include "halfspace.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+#define SUBPIXEL_SCALE (1 << SUBPIXEL_BITS)
+
+// Lane offsets of each block shape
+static const int lane_x[2][8] = { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 0, 1, 2, 3, 0, 1, 2, 3 } };
+static const int lane_y[2][8] = { { 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 1, 1, 1, 1 } };
+
+static int64_t floorDiv(int64_t value, int64_t divisor) {
+    int64_t q = value / divisor;
+    return (value % divisor != 0 && value < 0) ? q - 1 : q;
+}
+
+bool setupHalfSpace(const vec2 screen[3], const float z[3], HalfSpaceTriangle* triangle) {
+    int64_t px[3], py[3];
+    for (int k = 0; k < 3; k++) {
+        if (!(fabs(screen[k].x) < HALFSPACE_MAX_COORD && fabs(screen[k].y) < HALFSPACE_MAX_COORD)) {
+            return false;
+        }
+        // Snap to the sub-pixel grid
+        px[k] = llround(screen[k].x * SUBPIXEL_SCALE);
+        py[k] = llround(screen[k].y * SUBPIXEL_SCALE);
+        triangle->z[k] = z[k];
+    }
+
+    int64_t area = (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]);
+    if (area == 0) {
+        return false;
+    }
+    int64_t sign = area > 0 ? 1 : -1;
+
+    triangle->min_x = (int)(std::min(std::min(px[0], px[1]), px[2]) >> SUBPIXEL_BITS);
+    triangle->min_y = (int)(std::min(std::min(py[0], py[1]), py[2]) >> SUBPIXEL_BITS);
+    triangle->max_x = (int)(std::max(std::max(px[0], px[1]), px[2]) >> SUBPIXEL_BITS);
+    triangle->max_y = (int)(std::max(std::max(py[0], py[1]), py[2]) >> SUBPIXEL_BITS);
+
+    const int64_t half = SUBPIXEL_SCALE / 2;
+    double inv_area = 1.0 / (double)(area * sign);
+    for (int k = 0; k < 3; k++) {
+        int p = (k + 1) % 3;
+        int q = (k + 2) % 3;
+        int64_t dx = (px[q] - px[p]) * sign;
+        int64_t dy = (py[q] - py[p]) * sign;
+
+        // Edge at the center of pixel (0, 0); pixels on a top or left edge are inside
+        int64_t c = dx * (half - py[p]) - dy * (half - px[p]);
+        bool top_left = dy < 0 || (dy == 0 && dx > 0);
+        triangle->c[k] = floorDiv(c - (top_left ? 0 : 1), SUBPIXEL_SCALE);
+        triangle->a[k] = (int)-dy;
+        triangle->b[k] = (int)dx;
+
+        double c_min = (double)c + (double)SUBPIXEL_SCALE * ((double)-dy * triangle->min_x + (double)dx * triangle->min_y);
+        triangle->bary_c[k] = (float)(c_min * inv_area);
+        triangle->bary_a[k] = (float)(-dy * SUBPIXEL_SCALE * inv_area);
+        triangle->bary_b[k] = (float)(dx * SUBPIXEL_SCALE * inv_area);
+    }
+    return true;
+}
+
+ivec2 blockLane(BlockShape shape, int x, int y, int lane) {
+    return ivec2(x + lane_x[shape][lane], y + lane_y[shape][lane]);
+}
+
+bool isCovered(const HalfSpaceTriangle& triangle, int x, int y) {
+    for (int k = 0; k < 3; k++) {
+        if (triangle.c[k] + (int64_t)triangle.a[k] * x + (int64_t)triangle.b[k] * y < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static unsigned int scissorMask(BlockShape shape, int x, int y, int x0, int y0, int x1, int y1) {
+    unsigned int mask = 0;
+    for (int i = 0; i < 8; i++) {
+        int lx = x + lane_x[shape][i];
+        int ly = y + lane_y[shape][i];
+        mask |= (lx >= x0 && lx <= x1 && ly >= y0 && ly <= y1) ? 1u << i : 0;
+    }
+    return mask;
+}
+
+#ifdef __AVX2__
+// a * b + c, fused only when also compiled with -mfma (AVX2 alone does not imply FMA)
+static inline __m256 mulAdd(__m256 a, __m256 b, __m256 c) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#endif
+
+// Barycentrics and depth of the block lanes
+static void interpolateBlock(const HalfSpaceTriangle& triangle, BlockShape shape, RasterBlock* block) {
+    float fx = (float)(block->x - triangle.min_x);
+    float fy = (float)(block->y - triangle.min_y);
+    float dz1 = triangle.z[1] - triangle.z[0];
+    float dz2 = triangle.z[2] - triangle.z[0];
+
+#ifdef __AVX2__
+    __m256 ox = _mm256_add_ps(_mm256_set1_ps(fx), _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)lane_x[shape])));
+    __m256 oy = _mm256_add_ps(_mm256_set1_ps(fy), _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)lane_y[shape])));
+    __m256 l1 = mulAdd(_mm256_set1_ps(triangle.bary_b[1]), oy, mulAdd(_mm256_set1_ps(triangle.bary_a[1]), ox, _mm256_set1_ps(triangle.bary_c[1])));
+    __m256 l2 = mulAdd(_mm256_set1_ps(triangle.bary_b[2]), oy, mulAdd(_mm256_set1_ps(triangle.bary_a[2]), ox, _mm256_set1_ps(triangle.bary_c[2])));
+    __m256 z = mulAdd(l2, _mm256_set1_ps(dz2), mulAdd(l1, _mm256_set1_ps(dz1), _mm256_set1_ps(triangle.z[0])));
+    _mm256_store_ps(block->l1, l1);
+    _mm256_store_ps(block->l2, l2);
+    _mm256_store_ps(block->z, z);
+#else
+    for (int i = 0; i < 8; i++) {
+        float ox = fx + lane_x[shape][i];
+        float oy = fy + lane_y[shape][i];
+        block->l1[i] = triangle.bary_c[1] + triangle.bary_a[1] * ox + triangle.bary_b[1] * oy;
+        block->l2[i] = triangle.bary_c[2] + triangle.bary_a[2] * ox + triangle.bary_b[2] * oy;
+        block->z[i] = triangle.z[0] + block->l1[i] * dz1 + block->l2[i] * dz2;
+    }
+#endif
+}
+
+void rasterizeBlocks(const HalfSpaceTriangle& triangle, BlockShape shape, int x0, int y0, int x1, int y1, vector<RasterBlock>* blocks) {
+    x0 = std::max(x0, triangle.min_x);
+    y0 = std::max(y0, triangle.min_y);
+    x1 = std::min(x1, triangle.max_x);
+    y1 = std::min(y1, triangle.max_y);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    const int block_width = shape == BLOCK_8X1 ? 8 : 4;
+    const int block_height = shape == BLOCK_8X1 ? 1 : 2;
+    const int last = HALFSPACE_TILE_SIZE - 1;
+
+    // Edge values of each lane relative to the block origin
+    int lane_offset[3][8];
+    for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < 8; i++) {
+            lane_offset[k][i] = triangle.a[k] * lane_x[shape][i] + triangle.b[k] * lane_y[shape][i];
+        }
+    }
+
+    // Tiles on a fixed grid, so blocks of different triangles line up
+    int tile_x0 = (int)floorDiv(x0, HALFSPACE_TILE_SIZE) * HALFSPACE_TILE_SIZE;
+    int tile_y0 = (int)floorDiv(y0, HALFSPACE_TILE_SIZE) * HALFSPACE_TILE_SIZE;
+    for (int ty = tile_y0; ty <= y1; ty += HALFSPACE_TILE_SIZE) {
+        for (int tx = tile_x0; tx <= x1; tx += HALFSPACE_TILE_SIZE) {
+            // (1) Tile corners against each edge: outside rejects, inside skips the edge
+            int origin[3];
+            bool partial[3];
+            bool rejected = false;
+            for (int k = 0; k < 3; k++) {
+                int64_t e = triangle.c[k] + (int64_t)triangle.a[k] * tx + (int64_t)triangle.b[k] * ty;
+                int64_t e_max = e + (int64_t)std::max(triangle.a[k], 0) * last + (int64_t)std::max(triangle.b[k], 0) * last;
+                int64_t e_min = e + (int64_t)std::min(triangle.a[k], 0) * last + (int64_t)std::min(triangle.b[k], 0) * last;
+                rejected = rejected || e_max < 0;
+                partial[k] = e_min < 0;
+                // Values of partially covered edges are bounded by the tile size
+                origin[k] = partial[k] ? (int)e : 0;
+            }
+            if (rejected) {
+                continue;
+            }
+            bool clipped = tx < x0 || ty < y0 || tx + last > x1 || ty + last > y1;
+
+            // (2) Blocks, edge values stepped in 32 bits
+            for (int by = ty; by < ty + HALFSPACE_TILE_SIZE; by += block_height) {
+                if (by + block_height - 1 < y0 || by > y1) {
+                    continue;
+                }
+                int row[3];
+                for (int k = 0; k < 3; k++) {
+                    row[k] = partial[k] ? origin[k] + triangle.b[k] * (by - ty) : 0;
+                }
+
+#ifdef __AVX2__
+                __m256i e[3], step[3];
+                for (int k = 0; k < 3; k++) {
+                    __m256i offsets = partial[k] ? _mm256_loadu_si256((const __m256i*)lane_offset[k]) : _mm256_setzero_si256();
+                    e[k] = _mm256_add_epi32(_mm256_set1_epi32(row[k]), offsets);
+                    step[k] = _mm256_set1_epi32(partial[k] ? triangle.a[k] * block_width : 0);
+                }
+#endif
+                for (int bx = tx; bx < tx + HALFSPACE_TILE_SIZE; bx += block_width) {
+                    unsigned int mask;
+#ifdef __AVX2__
+                    // Sign bits of the three edges: a lane is covered when none is set
+                    __m256i any = _mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]);
+                    mask = ~(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(any)) & 0xFF;
+                    for (int k = 0; k < 3; k++) {
+                        e[k] = _mm256_add_epi32(e[k], step[k]);
+                    }
+#else
+                    mask = 0;
+                    for (int i = 0; i < 8; i++) {
+                        int any = 0;
+                        for (int k = 0; k < 3; k++) {
+                            any |= partial[k] ? row[k] + triangle.a[k] * (bx - tx) + lane_offset[k][i] : 0;
+                        }
+                        mask |= any >= 0 ? 1u << i : 0;
+                    }
+#endif
+                    if (clipped) {
+                        mask &= scissorMask(shape, bx, by, x0, y0, x1, y1);
+                    }
+                    if (mask == 0) {
+                        continue;
+                    }
+
+                    RasterBlock block;
+                    block.x = bx;
+                    block.y = by;
+                    block.mask = mask;
+                    interpolateBlock(triangle, shape, &block);
+                    blocks->push_back(block);
+                }
+            }
+        }
+    }
+}
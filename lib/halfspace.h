@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Fixed point sub-pixel bits of the vertex positions
+#define SUBPIXEL_BITS 8
+
+// Vertices must stay within this many pixels of the origin (guard band), for 32 bit stepping
+#define HALFSPACE_MAX_COORD 16384
+
+// Tiles tested against the edges before any block, in pixels
+#define HALFSPACE_TILE_SIZE 16
+
+enum BlockShape { BLOCK_8X1, BLOCK_4X2 };
+
+/**
+ * Triangle set up for the half-space kernels. Edge k is opposite to vertex k,
+ * its value at pixel (x, y) is c[k] + a[k] * x + b[k] * y, >= 0 inside.
+ * Values are divided by the sub-pixel scale after the top-left bias, so the
+ * sign test stays exact while pixel steps fit in 32 bits.
+ */
+struct HalfSpaceTriangle {
+    int64_t c[3];
+    int a[3];
+    int b[3];
+
+    /** Same edges in float divided by the area (barycentric weights), relative to pixel (min_x, min_y) */
+    float bary_c[3];
+    float bary_a[3];
+    float bary_b[3];
+
+    float z[3];
+
+    /** Pixel bounds (inclusive) */
+    int min_x, min_y, max_x, max_y;
+};
+
+/** 8 pixels: a row of 8 or two rows of 4. Bit i of mask is lane i */
+struct alignas(32) RasterBlock {
+    float l1[8];
+    float l2[8];
+    float z[8];
+    int x;
+    int y;
+    unsigned int mask;
+};
+
+/**
+ * Fixed point setup (sub-pixel snapping, edge equations, top-left rule).
+ * Either winding is accepted; returns false for degenerate triangles.
+ */
+bool setupHalfSpace(const glm::vec2 screen[3], const float z[3], HalfSpaceTriangle* triangle);
+
+/** Pixel of lane i of a block */
+glm::ivec2 blockLane(BlockShape shape, int x, int y, int lane);
+
+/**
+ * Appends the blocks of the triangle inside the rectangle [x0, x1] x [y0, y1]
+ * with at least one covered pixel. Tiles outside an edge are skipped, tiles
+ * inside every edge skip the edge tests. Uses AVX2 when compiled with it.
+ */
+void rasterizeBlocks(const HalfSpaceTriangle& triangle, BlockShape shape, int x0, int y0, int x1, int y1, std::vector<RasterBlock>* blocks);
+
+/** Scalar reference: coverage of one pixel */
+bool isCovered(const HalfSpaceTriangle& triangle, int x, int y);
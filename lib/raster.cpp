@@ -0,0 +1,263 @@
+#include "raster.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace glm;
+
+// Pixels written per block copy
+#define FILL_BLOCK_PIXELS 16
+
+RasterImage rasterImage(unsigned char* data, int width, int height, int channels) {
+    return RasterImage{ data, width, height, channels, width * channels };
+}
+
+static void addSpan(const RasterImage& image, int y, int x0, int x1, vector<Span>* spans) {
+    if (y < 0 || y >= image.height || x1 < 0 || x0 >= image.width || x1 < x0) {
+        return;
+    }
+    spans->push_back(Span{ y, std::max(x0, 0), std::min(x1, image.width - 1) });
+}
+
+// Bresenham, consecutive pixels of a row are merged into one span
+void lineSpans(const RasterImage& image, ivec2 p0, ivec2 p1, vector<Span>* spans) {
+    // Trivially outside
+    if ((p0.x < 0 && p1.x < 0) || (p0.y < 0 && p1.y < 0) || (p0.x >= image.width && p1.x >= image.width) || (p0.y >= image.height && p1.y >= image.height)) {
+        return;
+    }
+
+    int dx = abs(p1.x - p0.x);
+    int dy = -abs(p1.y - p0.y);
+    int sx = p0.x < p1.x ? 1 : -1;
+    int sy = p0.y < p1.y ? 1 : -1;
+    int err = dx + dy;
+
+    int x = p0.x, y = p0.y;
+    int run_y = y, run_min = x, run_max = x;
+    while (true) {
+        if (y != run_y) {
+            addSpan(image, run_y, run_min, run_max, spans);
+            run_y = y;
+            run_min = run_max = x;
+        } else {
+            run_min = std::min(run_min, x);
+            run_max = std::max(run_max, x);
+        }
+
+        if (x == p1.x && y == p1.y) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y += sy;
+        }
+    }
+    addSpan(image, run_y, run_min, run_max, spans);
+}
+
+// Rows of a shape symmetric around its center, half_widths[d] is the half width d rows away
+static void symmetricSpans(const RasterImage& image, ivec2 center, const vector<int>& half_widths, bool filled, vector<Span>* spans) {
+    int radius = (int)half_widths.size() - 1;
+    int first = std::max(-radius, -center.y);
+    int last = std::min(radius, image.height - 1 - center.y);
+
+    for (int dy = first; dy <= last; dy++) {
+        int d = abs(dy);
+        int y = center.y + dy;
+        int width = half_widths[d];
+        if (filled) {
+            addSpan(image, y, center.x - width, center.x + width, spans);
+            continue;
+        }
+
+        // Outline: the pixels past the narrower neighbor row
+        int inner = d + 1 <= radius ? half_widths[d + 1] + 1 : 0;
+        inner = std::min(inner, width);
+        if (inner == 0) {
+            addSpan(image, y, center.x - width, center.x + width, spans);
+        } else {
+            addSpan(image, y, center.x - width, center.x - inner, spans);
+            addSpan(image, y, center.x + inner, center.x + width, spans);
+        }
+    }
+}
+
+// Same midpoint steps as midPointCircleDraw, one half width per row
+void circleSpans(const RasterImage& image, ivec2 center, int radius, bool filled, vector<Span>* spans) {
+    if (radius < 0) {
+        return;
+    }
+
+    vector<int> half_widths(radius + 1, 0);
+    int x = radius, y = 0;
+    int p = 1 - radius;
+    while (x >= y) {
+        half_widths[y] = std::max(half_widths[y], x);
+        half_widths[x] = std::max(half_widths[x], y);
+        y++;
+        if (p <= 0) {
+            p = p + 2 * y + 1;
+        } else {
+            x--;
+            p = p + 2 * y - 2 * x + 1;
+        }
+    }
+    symmetricSpans(image, center, half_widths, filled, spans);
+}
+
+// Midpoint ellipse, region 1 steps in x and region 2 in y
+void ellipseSpans(const RasterImage& image, ivec2 center, int radius_x, int radius_y, bool filled, vector<Span>* spans) {
+    if (radius_x < 0 || radius_y < 0) {
+        return;
+    }
+    if (radius_x == 0 || radius_y == 0) {
+        lineSpans(image, center - ivec2(radius_x, radius_y), center + ivec2(radius_x, radius_y), spans);
+        return;
+    }
+
+    vector<int> half_widths(radius_y + 1, 0);
+    long long rx2 = (long long)radius_x * radius_x;
+    long long ry2 = (long long)radius_y * radius_y;
+    int x = 0, y = radius_y;
+    long long px = 0, py = 2 * rx2 * y;
+
+    double p = ry2 - rx2 * radius_y + 0.25 * rx2;
+    while (px < py) {
+        half_widths[y] = std::max(half_widths[y], x);
+        x++;
+        px += 2 * ry2;
+        if (p < 0) {
+            p += ry2 + px;
+        } else {
+            y--;
+            py -= 2 * rx2;
+            p += ry2 + px - py;
+        }
+    }
+
+    p = ry2 * (x + 0.5) * (x + 0.5) + rx2 * (double)(y - 1) * (y - 1) - rx2 * ry2;
+    while (y >= 0) {
+        half_widths[y] = std::max(half_widths[y], x);
+        y--;
+        py -= 2 * rx2;
+        if (p > 0) {
+            p += rx2 - py;
+        } else {
+            x++;
+            px += 2 * ry2;
+            p += rx2 - py + px;
+        }
+    }
+    symmetricSpans(image, center, half_widths, filled, spans);
+}
+
+// Scanline fill, even-odd rule, sampled at pixel centers
+void polygonSpans(const RasterImage& image, const vector<vec2>& polygon, vector<Span>* spans) {
+    struct Edge {
+        float y0, y1;
+        float x0, dxdy;
+    };
+
+    vector<Edge> edges;
+    float y_min = INFINITY, y_max = -INFINITY;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        vec2 a = polygon[i];
+        vec2 b = polygon[(i + 1) % polygon.size()];
+        if (a.y == b.y) {
+            continue;
+        }
+        if (a.y > b.y) {
+            swap(a, b);
+        }
+        edges.push_back(Edge{ a.y, b.y, a.x, (b.x - a.x) / (b.y - a.y) });
+        y_min = std::min(y_min, a.y);
+        y_max = std::max(y_max, b.y);
+    }
+    if (edges.empty()) {
+        return;
+    }
+
+    // Rows whose centers fall inside the polygon, clipped to the image
+    int first = std::max(0, (int)ceil(y_min - 0.5f));
+    int last = std::min(image.height - 1, (int)ceil(y_max - 0.5f) - 1);
+    sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+
+    vector<const Edge*> active;
+    vector<float> crossings;
+    size_t next_edge = 0;
+    for (int y = first; y <= last; y++) {
+        float yc = y + 0.5f;
+        while (next_edge < edges.size() && edges[next_edge].y0 <= yc) {
+            active.push_back(&edges[next_edge++]);
+        }
+        active.erase(remove_if(active.begin(), active.end(), [yc](const Edge* e) { return e->y1 <= yc; }), active.end());
+
+        crossings.clear();
+        for (const Edge* e : active) {
+            crossings.push_back(e->x0 + (yc - e->y0) * e->dxdy);
+        }
+        sort(crossings.begin(), crossings.end());
+
+        // Pixel x is covered when its center is in [a, b)
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            int x0 = (int)ceil(crossings[i] - 0.5f);
+            int x1 = (int)ceil(crossings[i + 1] - 0.5f) - 1;
+            addSpan(image, y, x0, x1, spans);
+        }
+    }
+}
+
+template <int N>
+static void fillSpansN(const RasterImage& image, const vector<Span>& spans, const unsigned char* color) {
+    // A block of pixels copied with fixed size memcpy, which compiles to vector stores
+    const int block_bytes = FILL_BLOCK_PIXELS * N;
+    unsigned char block[block_bytes];
+    for (int i = 0; i < FILL_BLOCK_PIXELS; i++) {
+        memcpy(block + i * N, color, N);
+    }
+
+    for (const Span& span : spans) {
+        unsigned char* dst = image.data + (size_t)span.y * image.stride + (size_t)span.x0 * N;
+        int count = span.x1 - span.x0 + 1;
+        for (; count >= FILL_BLOCK_PIXELS; count -= FILL_BLOCK_PIXELS) {
+            memcpy(dst, block, block_bytes);
+            dst += block_bytes;
+        }
+        for (; count > 0; count--) {
+            memcpy(dst, color, N);
+            dst += N;
+        }
+    }
+}
+
+void fillSpans(const RasterImage& image, const vector<Span>& spans, const unsigned char* color) {
+    switch (image.channels) {
+        case 1:
+            fillSpansN<1>(image, spans, color);
+            break;
+        case 2:
+            fillSpansN<2>(image, spans, color);
+            break;
+        case 3:
+            fillSpansN<3>(image, spans, color);
+            break;
+        default:
+            fillSpansN<4>(image, spans, color);
+            break;
+    }
+}
+
+void clearImage(const RasterImage& image, const unsigned char* color) {
+    vector<Span> rows;
+    for (int y = 0; y < image.height; y++) {
+        rows.push_back(Span{ y, 0, image.width - 1 });
+    }
+    fillSpans(image, rows, color);
+}
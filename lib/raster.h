@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+/** 8 bit image in memory, 1 to 4 channels, rows stride bytes apart */
+struct RasterImage {
+    unsigned char* data;
+    int width;
+    int height;
+    int channels;
+    int stride;
+};
+
+/** Pixels x0 to x1 (inclusive) of row y, already clipped to the image */
+struct Span {
+    int y;
+    int x0;
+    int x1;
+};
+
+RasterImage rasterImage(unsigned char* data, int width, int height, int channels);
+
+// Span generators: append the spans of a shape, clipped once against the image
+void lineSpans(const RasterImage& image, glm::ivec2 p0, glm::ivec2 p1, std::vector<Span>* spans);
+void circleSpans(const RasterImage& image, glm::ivec2 center, int radius, bool filled, std::vector<Span>* spans);
+void ellipseSpans(const RasterImage& image, glm::ivec2 center, int radius_x, int radius_y, bool filled, std::vector<Span>* spans);
+void polygonSpans(const RasterImage& image, const std::vector<glm::vec2>& polygon, std::vector<Span>* spans);
+
+/** Writes color (image.channels bytes) over every span, in blocks of 16 pixels */
+void fillSpans(const RasterImage& image, const std::vector<Span>& spans, const unsigned char* color);
+
+void clearImage(const RasterImage& image, const unsigned char* color);
@@ -0,0 +1,227 @@
+// Edge functions must not be fused into fma, shared edges would then differ between triangles
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "raytri.h"
+#include <cmath>
+#include <utility>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+WatertightRay setupRay(vec3 origin, vec3 direction) {
+    WatertightRay ray;
+    ray.origin = origin;
+
+    vec3 d = abs(direction);
+    ray.kz = d.x > d.y ? (d.x > d.z ? 0 : 2) : (d.y > d.z ? 1 : 2);
+    ray.kx = (ray.kz + 1) % 3;
+    ray.ky = (ray.kx + 1) % 3;
+    // Keeps the winding
+    if (direction[ray.kz] < 0.0f) {
+        swap(ray.kx, ray.ky);
+    }
+
+    ray.sx = direction[ray.kx] / direction[ray.kz];
+    ray.sy = direction[ray.ky] / direction[ray.kz];
+    ray.sz = 1.0f / direction[ray.kz];
+    return ray;
+}
+
+void setupRays(const RayPacket& rays, WatertightRayPacket* out) {
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        vec3 origin(rays.origin[0][i], rays.origin[1][i], rays.origin[2][i]);
+        vec3 direction(rays.direction[0][i], rays.direction[1][i], rays.direction[2][i]);
+        WatertightRay ray = setupRay(origin, direction);
+        for (int k = 0; k < 3; k++) {
+            out->origin[k][i] = origin[k];
+        }
+        out->sx[i] = ray.sx;
+        out->sy[i] = ray.sy;
+        out->sz[i] = ray.sz;
+        out->kx[i] = ray.kx;
+        out->ky[i] = ray.ky;
+        out->kz[i] = ray.kz;
+        out->t_min[i] = rays.t_min[i];
+        out->t_max[i] = rays.t_max[i];
+    }
+}
+
+void setTriangle(TrianglePacket* packet, int lane, vec3 v0, vec3 v1, vec3 v2) {
+    const vec3 v[3] = { v0, v1, v2 };
+    for (int k = 0; k < 3; k++) {
+        for (int axis = 0; axis < 3; axis++) {
+            packet->vertices[k][axis][lane] = v[k][axis];
+        }
+    }
+}
+
+bool intersectTriangle(const WatertightRay& ray, vec3 v0, vec3 v1, vec3 v2, float t_min, float t_max, TriangleHit* hit) {
+    // Indexed by the permuted axes, plain arrays stay in registers
+    const float a[3] = { v0.x - ray.origin.x, v0.y - ray.origin.y, v0.z - ray.origin.z };
+    const float b[3] = { v1.x - ray.origin.x, v1.y - ray.origin.y, v1.z - ray.origin.z };
+    const float c[3] = { v2.x - ray.origin.x, v2.y - ray.origin.y, v2.z - ray.origin.z };
+
+    // Sheared vertices, the ray is now the +z axis
+    float ax = a[ray.kx] - ray.sx * a[ray.kz];
+    float ay = a[ray.ky] - ray.sy * a[ray.kz];
+    float bx = b[ray.kx] - ray.sx * b[ray.kz];
+    float by = b[ray.ky] - ray.sy * b[ray.kz];
+    float cx = c[ray.kx] - ray.sx * c[ray.kz];
+    float cy = c[ray.ky] - ray.sy * c[ray.kz];
+
+    // Edge k is opposite to vertex k
+    float e0 = cx * by - cy * bx;
+    float e1 = ax * cy - ay * cx;
+    float e2 = bx * ay - by * ax;
+    if (e0 == 0.0f || e1 == 0.0f || e2 == 0.0f) {
+        e0 = (float)((double)cx * by - (double)cy * bx);
+        e1 = (float)((double)ax * cy - (double)ay * cx);
+        e2 = (float)((double)bx * ay - (double)by * ax);
+    }
+    if ((e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) && (e0 > 0.0f || e1 > 0.0f || e2 > 0.0f)) {
+        return false;
+    }
+    float det = e0 + e1 + e2;
+    if (det == 0.0f) {
+        return false;
+    }
+
+    float az = ray.sz * a[ray.kz];
+    float bz = ray.sz * b[ray.kz];
+    float cz = ray.sz * c[ray.kz];
+    float t = (e0 * az + e1 * bz + e2 * cz) / det;
+    if (!(t > t_min && t < t_max)) {
+        return false;
+    }
+
+    float inv_det = 1.0f / det;
+    hit->t = t;
+    hit->u = e1 * inv_det;
+    hit->v = e2 * inv_det;
+    return true;
+}
+
+#ifdef __AVX2__
+// Same steps as intersectTriangle on 8 lanes, vertices relative to the ray origins and
+// already permuted; lanes with an edge exactly at zero are returned in redo
+static unsigned int intersectLanes(const __m256 x[3], const __m256 y[3], const __m256 z[3], __m256 sx, __m256 sy, __m256 sz, __m256 t_min, __m256 t_max, PacketHit* hits, unsigned int* redo) {
+    __m256 px[3], py[3], pz[3];
+    for (int k = 0; k < 3; k++) {
+        px[k] = _mm256_sub_ps(x[k], _mm256_mul_ps(sx, z[k]));
+        py[k] = _mm256_sub_ps(y[k], _mm256_mul_ps(sy, z[k]));
+        pz[k] = _mm256_mul_ps(sz, z[k]);
+    }
+
+    __m256 e0 = _mm256_sub_ps(_mm256_mul_ps(px[2], py[1]), _mm256_mul_ps(py[2], px[1]));
+    __m256 e1 = _mm256_sub_ps(_mm256_mul_ps(px[0], py[2]), _mm256_mul_ps(py[0], px[2]));
+    __m256 e2 = _mm256_sub_ps(_mm256_mul_ps(px[1], py[0]), _mm256_mul_ps(py[1], px[0]));
+
+    __m256 zero = _mm256_setzero_ps();
+    __m256 any_zero = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_EQ_OQ), _mm256_cmp_ps(e1, zero, _CMP_EQ_OQ)), _mm256_cmp_ps(e2, zero, _CMP_EQ_OQ));
+    __m256 any_neg = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_LT_OQ), _mm256_cmp_ps(e1, zero, _CMP_LT_OQ)), _mm256_cmp_ps(e2, zero, _CMP_LT_OQ));
+    __m256 any_pos = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(e0, zero, _CMP_GT_OQ), _mm256_cmp_ps(e1, zero, _CMP_GT_OQ)), _mm256_cmp_ps(e2, zero, _CMP_GT_OQ));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(e0, e1), e2);
+    __m256 inside = _mm256_andnot_ps(_mm256_and_ps(any_neg, any_pos), _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+
+    __m256 inv_det = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+    __m256 t_scaled = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e0, pz[0]), _mm256_mul_ps(e1, pz[1])), _mm256_mul_ps(e2, pz[2]));
+    __m256 t = _mm256_div_ps(t_scaled, det);
+    inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(t, t_min, _CMP_GT_OQ), _mm256_cmp_ps(t, t_max, _CMP_LT_OQ)));
+
+    _mm256_store_ps(hits->t, t);
+    _mm256_store_ps(hits->u, _mm256_mul_ps(e1, inv_det));
+    _mm256_store_ps(hits->v, _mm256_mul_ps(e2, inv_det));
+
+    *redo = (unsigned int)_mm256_movemask_ps(any_zero);
+    return (unsigned int)_mm256_movemask_ps(inside) & ~*redo;
+}
+
+// Lane-wise a[k[i]] for k in 0..2
+static inline __m256 selectAxis(const __m256 a[3], __m256i k) {
+    __m256 is_0 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(k, _mm256_setzero_si256()));
+    __m256 is_1 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(k, _mm256_set1_epi32(1)));
+    return _mm256_blendv_ps(_mm256_blendv_ps(a[2], a[1], is_1), a[0], is_0);
+}
+#endif
+
+// Lanes redone by the scalar test, for edges exactly at zero or without AVX2
+static unsigned int redoLane(const WatertightRay& ray, vec3 v0, vec3 v1, vec3 v2, float t_min, float t_max, int lane, PacketHit* hits) {
+    TriangleHit hit;
+    if (!intersectTriangle(ray, v0, v1, v2, t_min, t_max, &hit)) {
+        return 0;
+    }
+    hits->t[lane] = hit.t;
+    hits->u[lane] = hit.u;
+    hits->v[lane] = hit.v;
+    return 1u << lane;
+}
+
+static vec3 packetVertex(const TrianglePacket& triangles, int k, int lane) {
+    return vec3(triangles.vertices[k][0][lane], triangles.vertices[k][1][lane], triangles.vertices[k][2][lane]);
+}
+
+static WatertightRay packetRay(const WatertightRayPacket& rays, int lane) {
+    WatertightRay ray;
+    ray.origin = vec3(rays.origin[0][lane], rays.origin[1][lane], rays.origin[2][lane]);
+    ray.kx = rays.kx[lane];
+    ray.ky = rays.ky[lane];
+    ray.kz = rays.kz[lane];
+    ray.sx = rays.sx[lane];
+    ray.sy = rays.sy[lane];
+    ray.sz = rays.sz[lane];
+    return ray;
+}
+
+unsigned int intersectTriangles(const WatertightRay& ray, const TrianglePacket& triangles, float t_min, float t_max, PacketHit* hits) {
+    unsigned int redo = (1u << RAY_PACKET_SIZE) - 1;
+    unsigned int mask = 0;
+#ifdef __AVX2__
+    __m256 x[3], y[3], z[3];
+    for (int k = 0; k < 3; k++) {
+        x[k] = _mm256_sub_ps(_mm256_load_ps(triangles.vertices[k][ray.kx]), _mm256_set1_ps(ray.origin[ray.kx]));
+        y[k] = _mm256_sub_ps(_mm256_load_ps(triangles.vertices[k][ray.ky]), _mm256_set1_ps(ray.origin[ray.ky]));
+        z[k] = _mm256_sub_ps(_mm256_load_ps(triangles.vertices[k][ray.kz]), _mm256_set1_ps(ray.origin[ray.kz]));
+    }
+    mask = intersectLanes(x, y, z, _mm256_set1_ps(ray.sx), _mm256_set1_ps(ray.sy), _mm256_set1_ps(ray.sz), _mm256_set1_ps(t_min), _mm256_set1_ps(t_max), hits, &redo);
+#endif
+    for (; redo; redo &= redo - 1) {
+        int lane = __builtin_ctz(redo);
+        mask |= redoLane(ray, packetVertex(triangles, 0, lane), packetVertex(triangles, 1, lane), packetVertex(triangles, 2, lane), t_min, t_max, lane, hits);
+    }
+    return mask;
+}
+
+unsigned int intersectRays(const WatertightRayPacket& rays, vec3 v0, vec3 v1, vec3 v2, PacketHit* hits) {
+    unsigned int redo = (1u << RAY_PACKET_SIZE) - 1;
+    unsigned int mask = 0;
+#ifdef __AVX2__
+    const vec3 v[3] = { v0, v1, v2 };
+    __m256i kx = _mm256_load_si256((const __m256i*)rays.kx);
+    __m256i ky = _mm256_load_si256((const __m256i*)rays.ky);
+    __m256i kz = _mm256_load_si256((const __m256i*)rays.kz);
+    __m256 x[3], y[3], z[3];
+    for (int k = 0; k < 3; k++) {
+        __m256 d[3];
+        for (int axis = 0; axis < 3; axis++) {
+            d[axis] = _mm256_sub_ps(_mm256_set1_ps(v[k][axis]), _mm256_load_ps(rays.origin[axis]));
+        }
+        x[k] = selectAxis(d, kx);
+        y[k] = selectAxis(d, ky);
+        z[k] = selectAxis(d, kz);
+    }
+    mask = intersectLanes(x, y, z, _mm256_load_ps(rays.sx), _mm256_load_ps(rays.sy), _mm256_load_ps(rays.sz), _mm256_load_ps(rays.t_min), _mm256_load_ps(rays.t_max), hits, &redo);
+#endif
+    for (; redo; redo &= redo - 1) {
+        int lane = __builtin_ctz(redo);
+        mask |= redoLane(packetRay(rays, lane), v0, v1, v2, rays.t_min[lane], rays.t_max[lane], lane, hits);
+    }
+    return mask;
+}
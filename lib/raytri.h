@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Lanes of the packet kernels
+#define RAY_PACKET_SIZE 8
+
+/**
+ * Ray set up for the watertight test (Woop, Benthin and Wald): the axes are
+ * permuted so kz is the largest direction component, then vertices are
+ * sheared so the ray runs along +z from the origin.
+ */
+struct WatertightRay {
+    glm::vec3 origin;
+    int kx, ky, kz;
+    float sx, sy, sz;
+};
+
+/** Distance along the direction and barycentrics (weights of vertices 1 and 2) */
+struct TriangleHit {
+    float t;
+    float u;
+    float v;
+};
+
+/** 8 triangles, structure of arrays: [vertex][axis][lane] */
+struct alignas(32) TrianglePacket {
+    float vertices[3][3][RAY_PACKET_SIZE];
+};
+
+/** 8 rays, structure of arrays: [axis][lane] */
+struct alignas(32) RayPacket {
+    float origin[3][RAY_PACKET_SIZE];
+    float direction[3][RAY_PACKET_SIZE];
+    float t_min[RAY_PACKET_SIZE];
+    float t_max[RAY_PACKET_SIZE];
+};
+
+/** RayPacket with the watertight setup of each lane */
+struct alignas(32) WatertightRayPacket {
+    float origin[3][RAY_PACKET_SIZE];
+    float sx[RAY_PACKET_SIZE];
+    float sy[RAY_PACKET_SIZE];
+    float sz[RAY_PACKET_SIZE];
+    int kx[RAY_PACKET_SIZE];
+    int ky[RAY_PACKET_SIZE];
+    int kz[RAY_PACKET_SIZE];
+    float t_min[RAY_PACKET_SIZE];
+    float t_max[RAY_PACKET_SIZE];
+};
+
+struct alignas(32) PacketHit {
+    float t[RAY_PACKET_SIZE];
+    float u[RAY_PACKET_SIZE];
+    float v[RAY_PACKET_SIZE];
+};
+
+WatertightRay setupRay(glm::vec3 origin, glm::vec3 direction);
+void setupRays(const RayPacket& rays, WatertightRayPacket* out);
+
+/** Fills one lane, unused lanes can stay zero (degenerate triangles never hit) */
+void setTriangle(TrianglePacket* packet, int lane, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+
+/**
+ * Both faces, hits in (t_min, t_max). Rays through a shared edge or vertex hit
+ * at least one of the triangles. Edges exactly at zero are redone in double.
+ */
+bool intersectTriangle(const WatertightRay& ray, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, float t_min, float t_max, TriangleHit* hit);
+
+/** One ray against 8 triangles, bit i of the result is lane i. Uses AVX2 when compiled with it */
+unsigned int intersectTriangles(const WatertightRay& ray, const TrianglePacket& triangles, float t_min, float t_max, PacketHit* hits);
+
+/** 8 rays against one triangle, bit i of the result is lane i. Uses AVX2 when compiled with it */
+unsigned int intersectRays(const WatertightRayPacket& rays, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, PacketHit* hits);
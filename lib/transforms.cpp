@@ -0,0 +1,298 @@
+#include "transforms.h"
+#include <cstdlib>
+#include <iostream>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+TransformStore::TransformStore() {
+    num_objects = 0;
+}
+
+unsigned int TransformStore::addObject(int parent, vec3 t, const quat& r, vec3 s) {
+    if (parent != TRANSFORM_ROOT && (parent < 0 || parent >= (int)num_objects)) {
+        cerr << "Transform parent " << parent << " does not exist!" << endl;
+        exit(-1);
+    }
+
+    // Grows a whole batch of identities at a time, the AVX2 path never reads past the arrays
+    if (num_objects % TRANSFORM_BATCH == 0) {
+        parents.resize(num_objects + TRANSFORM_BATCH, TRANSFORM_ROOT);
+        for (int k = 0; k < 3; k++) {
+            translation[k].resize(num_objects + TRANSFORM_BATCH, 0.0f);
+            scale[k].resize(num_objects + TRANSFORM_BATCH, 1.0f);
+        }
+        for (int k = 0; k < 4; k++) {
+            rotation[k].resize(num_objects + TRANSFORM_BATCH, k == 3 ? 1.0f : 0.0f);
+        }
+        for (int k = 0; k < 12; k++) {
+            world[k].resize(num_objects + TRANSFORM_BATCH, k == 0 || k == 4 || k == 8 ? 1.0f : 0.0f);
+        }
+        serial_batches.push_back(0);
+    }
+
+    unsigned int object = num_objects++;
+    parents[object] = parent;
+    setTranslation(object, t);
+    setRotation(object, r);
+    setScale(object, s);
+
+    // A parent composed in the same batch has to be finished before its child
+    if (parent != TRANSFORM_ROOT && parent >= (int)(object - object % TRANSFORM_BATCH)) {
+        serial_batches[object / TRANSFORM_BATCH] = 1;
+    }
+    return object;
+}
+
+void TransformStore::clear() {
+    num_objects = 0;
+    parents.clear();
+    for (int k = 0; k < 3; k++) {
+        translation[k].clear();
+        scale[k].clear();
+    }
+    for (int k = 0; k < 4; k++) {
+        rotation[k].clear();
+    }
+    for (int k = 0; k < 12; k++) {
+        world[k].clear();
+    }
+    serial_batches.clear();
+}
+
+void TransformStore::setTranslation(unsigned int object, vec3 t) {
+    translation[0][object] = t.x;
+    translation[1][object] = t.y;
+    translation[2][object] = t.z;
+}
+
+void TransformStore::setRotation(unsigned int object, const quat& r) {
+    rotation[0][object] = r.x;
+    rotation[1][object] = r.y;
+    rotation[2][object] = r.z;
+    rotation[3][object] = r.w;
+}
+
+void TransformStore::setScale(unsigned int object, vec3 s) {
+    scale[0][object] = s.x;
+    scale[1][object] = s.y;
+    scale[2][object] = s.z;
+}
+
+// Same products as the AVX2 path, for serial batches and builds without it
+void TransformStore::composeObject(unsigned int i) {
+    float x = rotation[0][i], y = rotation[1][i], z = rotation[2][i], w = rotation[3][i];
+    float xx = 2.0f * x * x, yy = 2.0f * y * y, zz = 2.0f * z * z;
+    float xy = 2.0f * x * y, xz = 2.0f * x * z, yz = 2.0f * y * z;
+    float wx = 2.0f * w * x, wy = 2.0f * w * y, wz = 2.0f * w * z;
+    float sx = scale[0][i], sy = scale[1][i], sz = scale[2][i];
+
+    float local[12] = {
+        (1.0f - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx,
+        (xy - wz) * sy, (1.0f - (xx + zz)) * sy, (yz + wx) * sy,
+        (xz + wy) * sz, (yz - wx) * sz, (1.0f - (xx + yy)) * sz,
+        translation[0][i], translation[1][i], translation[2][i],
+    };
+
+    int parent = parents[i];
+    if (parent == TRANSFORM_ROOT) {
+        for (int k = 0; k < 12; k++) {
+            world[k][i] = local[k];
+        }
+        return;
+    }
+
+    float p[12];
+    for (int k = 0; k < 12; k++) {
+        p[k] = world[k][parent];
+    }
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 3; r++) {
+            float v = p[r] * local[c * 3] + p[3 + r] * local[c * 3 + 1] + p[6 + r] * local[c * 3 + 2];
+            world[c * 3 + r][i] = c == 3 ? v + p[9 + r] : v;
+        }
+    }
+}
+
+#ifdef __AVX2__
+
+static void transpose8(__m256 r[8]) {
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44), s1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44), s3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44), s5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44), s7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+
+    r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+    r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+    r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+    r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+    r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+    r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+    r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+    r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+void TransformStore::composeBatch(unsigned int first) {
+    __m256 x = _mm256_loadu_ps(&rotation[0][first]);
+    __m256 y = _mm256_loadu_ps(&rotation[1][first]);
+    __m256 z = _mm256_loadu_ps(&rotation[2][first]);
+    __m256 w = _mm256_loadu_ps(&rotation[3][first]);
+    __m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+    __m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+    __m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+    __m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+    __m256 sx = _mm256_loadu_ps(&scale[0][first]);
+    __m256 sy = _mm256_loadu_ps(&scale[1][first]);
+    __m256 sz = _mm256_loadu_ps(&scale[2][first]);
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 local[12] = {
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+        _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+        _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+        _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+        _mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+        _mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+        _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+        _mm256_loadu_ps(&translation[0][first]),
+        _mm256_loadu_ps(&translation[1][first]),
+        _mm256_loadu_ps(&translation[2][first]),
+    };
+
+    __m256i parent = _mm256_loadu_si256((const __m256i*)&parents[first]);
+    __m256i has_parent = _mm256_cmpgt_epi32(parent, _mm256_set1_epi32(TRANSFORM_ROOT));
+    if (_mm256_testz_si256(has_parent, has_parent)) {
+        for (int k = 0; k < 12; k++) {
+            _mm256_storeu_ps(&world[k][first], local[k]);
+        }
+        return;
+    }
+
+    // Roots gather the identity
+    __m256 p[12];
+    __m256 mask = _mm256_castsi256_ps(has_parent);
+    for (int k = 0; k < 12; k++) {
+        __m256 identity = k == 0 || k == 4 || k == 8 ? one : _mm256_setzero_ps();
+        p[k] = _mm256_mask_i32gather_ps(identity, world[k].data(), parent, mask, 4);
+    }
+
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 3; r++) {
+            __m256 v = _mm256_mul_ps(p[r], local[c * 3]);
+            v = _mm256_add_ps(v, _mm256_mul_ps(p[3 + r], local[c * 3 + 1]));
+            v = _mm256_add_ps(v, _mm256_mul_ps(p[6 + r], local[c * 3 + 2]));
+            if (c == 3) {
+                v = _mm256_add_ps(v, p[9 + r]);
+            }
+            _mm256_storeu_ps(&world[c * 3 + r][first], v);
+        }
+    }
+}
+
+void TransformStore::writeBatch(unsigned int first, float* instance_matrices) const {
+    // Rows are matrix elements, transposed into one column major mat4 per object
+    __m256 zero = _mm256_setzero_ps();
+    __m256 lo[8], hi[8];
+    for (int c = 0; c < 2; c++) {
+        for (int r = 0; r < 3; r++) {
+            lo[c * 4 + r] = _mm256_loadu_ps(&world[c * 3 + r][first]);
+            hi[c * 4 + r] = _mm256_loadu_ps(&world[(c + 2) * 3 + r][first]);
+        }
+        lo[c * 4 + 3] = zero;
+        hi[c * 4 + 3] = zero;
+    }
+    hi[7] = _mm256_set1_ps(1.0f);
+    transpose8(lo);
+    transpose8(hi);
+
+    unsigned int count = num_objects - first < TRANSFORM_BATCH ? num_objects - first : TRANSFORM_BATCH;
+    float* out = instance_matrices + (size_t)first * TRANSFORM_MATRIX_FLOATS;
+    for (unsigned int i = 0; i < count; i++) {
+        _mm256_storeu_ps(out + i * TRANSFORM_MATRIX_FLOATS, lo[i]);
+        _mm256_storeu_ps(out + i * TRANSFORM_MATRIX_FLOATS + 8, hi[i]);
+    }
+}
+
+#else
+
+void TransformStore::composeBatch(unsigned int first) {
+    for (unsigned int i = first; i < first + TRANSFORM_BATCH; i++) {
+        composeObject(i);
+    }
+}
+
+void TransformStore::writeBatch(unsigned int first, float* instance_matrices) const {
+    unsigned int last = num_objects - first < TRANSFORM_BATCH ? num_objects : first + TRANSFORM_BATCH;
+    for (unsigned int i = first; i < last; i++) {
+        float* out = instance_matrices + (size_t)i * TRANSFORM_MATRIX_FLOATS;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 3; r++) {
+                out[c * 4 + r] = world[c * 3 + r][i];
+            }
+            out[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+        }
+    }
+}
+
+#endif
+
+void TransformStore::updateWorldMatrices(float* instance_matrices) {
+    for (unsigned int first = 0; first < num_objects; first += TRANSFORM_BATCH) {
+        if (serial_batches[first / TRANSFORM_BATCH]) {
+            for (unsigned int i = first; i < first + TRANSFORM_BATCH; i++) {
+                composeObject(i);
+            }
+        } else {
+            composeBatch(first);
+        }
+
+        // Written while the batch is still in cache
+        if (instance_matrices != nullptr) {
+            writeBatch(first, instance_matrices);
+        }
+    }
+}
+
+unsigned int TransformStore::getNumObjects() const { return num_objects; }
+int TransformStore::getParent(unsigned int object) const { return parents[object]; }
+
+vec3 TransformStore::getTranslation(unsigned int object) const {
+    return vec3(translation[0][object], translation[1][object], translation[2][object]);
+}
+
+quat TransformStore::getRotation(unsigned int object) const {
+    return quat(rotation[3][object], rotation[0][object], rotation[1][object], rotation[2][object]);
+}
+
+vec3 TransformStore::getScale(unsigned int object) const {
+    return vec3(scale[0][object], scale[1][object], scale[2][object]);
+}
+
+mat4 TransformStore::getWorldMatrix(unsigned int object) const {
+    mat4 m(1.0f);
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 3; r++) {
+            m[c][r] = world[c * 3 + r][object];
+        }
+    }
+    return m;
+}
+
+unsigned int TransformStore::getNumSerialBatches() const {
+    unsigned int count = 0;
+    for (unsigned char serial : serial_batches) {
+        count += serial;
+    }
+    return count;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Parent index of the root objects
+#define TRANSFORM_ROOT -1
+
+// Objects composed together by the AVX2 path
+#define TRANSFORM_BATCH 8
+
+// Floats per matrix written by updateWorldMatrices (column major mat4)
+#define TRANSFORM_MATRIX_FLOATS 16
+
+/**
+ * Translation, rotation (unit quaternion) and scale of many objects kept as
+ * structure of arrays, in topological order (parents before their children).
+ * updateWorldMatrices() composes T * R * S and the parent products for 8
+ * objects at a time (AVX2 when compiled with it) and writes the world
+ * matrices straight into an instance buffer.
+ */
+class TransformStore {
+   public:
+    TransformStore();
+
+    /** Appended after its parent */
+    unsigned int addObject(int parent, glm::vec3 translation, const glm::quat& rotation, glm::vec3 scale);
+    void clear();
+
+    void setTranslation(unsigned int object, glm::vec3 translation);
+    void setRotation(unsigned int object, const glm::quat& rotation);
+    void setScale(unsigned int object, glm::vec3 scale);
+
+    /**
+     * Recomputes every world matrix. instance_matrices gets 16 floats per
+     * object, written in order and never read back, so it can be a mapped
+     * (write combined) buffer. nullptr only updates the store.
+     */
+    void updateWorldMatrices(float* instance_matrices);
+
+    unsigned int getNumObjects() const;
+    int getParent(unsigned int object) const;
+    glm::vec3 getTranslation(unsigned int object) const;
+    glm::quat getRotation(unsigned int object) const;
+    glm::vec3 getScale(unsigned int object) const;
+    glm::mat4 getWorldMatrix(unsigned int object) const;
+
+    /** Batches with a parent inside the batch itself, composed one object at a time */
+    unsigned int getNumSerialBatches() const;
+
+   private:
+    unsigned int num_objects;
+
+    // Padded to a multiple of TRANSFORM_BATCH with identity transforms
+    std::vector<int> parents;
+    std::vector<float> translation[3];
+    std::vector<float> rotation[4];
+    std::vector<float> scale[3];
+
+    // 3x4 affine part of the world matrices, element [column * 3 + row]
+    std::vector<float> world[12];
+
+    std::vector<unsigned char> serial_batches;
+
+    void composeObject(unsigned int object);
+    void composeBatch(unsigned int first);
+    void writeBatch(unsigned int first, float* instance_matrices) const;
+};
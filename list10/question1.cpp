@@ -5,6 +5,7 @@
 #include <glm/gtx/string_cast.hpp>
 #include "../lib/utils.h"
 #include "../lib/euclidian.h"
+#include "../lib/raster.h"
 
 using namespace std;
 using namespace glm;
@@ -172,35 +173,27 @@ void initData() {
 }
 
 void generateTexture() {
-    for (int y = 0; y < TEXT_HEIGHT; y++) {
-        for (int x = 0; x < TEXT_WIDTH; x++) {
-            for (int c = 0; c < 3; c++) {
-                text_data[y][x][c] = bg_color[c] * 255;
-            }
-        }
-    }
+    RasterImage image = rasterImage(&text_data[0][0][0], TEXT_WIDTH, TEXT_HEIGHT, 3);
 
-    vector<ivec2> circle_points = midPointCircleDraw(circle_center, circle_radius);
+    unsigned char bg[3], circle[3], center[3];
+    for (int c = 0; c < 3; c++) {
+        bg[c] = bg_color[c] * 255;
+        circle[c] = circle_color[c] * 255;
+        center[c] = center_color[c] * 255;
+    }
+    clearImage(image, bg);
 
     ivec2 text_center(TEXT_WIDTH / 2, TEXT_HEIGHT / 2);
 
     ivec2 text_circle_center = text_center + circle_center;
     if (inTexture(text_circle_center)) {
-        for (int c = 0; c < 3; c++) {
-            text_data[text_circle_center.y][text_circle_center.x][c] = center_color[c] * 255;
-        }
+        fillSpans(image, { Span{ text_circle_center.y, text_circle_center.x, text_circle_center.x } }, center);
     }
 
-    for (ivec2 p : circle_points) {
-        cout << to_string(p) << endl;
-
-        ivec2 text_p = text_center + p;
-        if (inTexture(text_p)) {
-            for (int c = 0; c < 3; c++) {
-                text_data[text_p.y][text_p.x][c] = circle_color[c] * 255;
-            }
-        }
-    }
+    // Circle rows as spans, already clipped to the texture
+    vector<Span> spans;
+    circleSpans(image, text_circle_center, circle_radius, false, &spans);
+    fillSpans(image, spans, circle);
 }
 
 bool inTexture(ivec2 p) {
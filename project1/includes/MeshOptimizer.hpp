@@ -0,0 +1,36 @@
+/**
+ * Triangle and vertex reordering for indexed meshes.
+ * Vertex cache: Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Tipsify)
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Post-transform vertex cache size (FIFO) assumed by the optimizer and by the ACMR report
+#define VERTEX_CACHE_SIZE 16
+
+// Maximum ACMR growth allowed when splitting clusters for overdraw
+#define OVERDRAW_THRESHOLD 1.05f
+
+class MeshOptimizer {
+   public:
+    /** Reorders triangles so that their vertices are reused while still in the cache */
+    static void optimize_vertex_cache(std::vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size);
+
+    /** Reorders clusters of the cache-optimized triangles so that outward facing ones are drawn first */
+    static void optimize_overdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, unsigned int cache_size, float threshold);
+
+    /** Renumbers vertices in first use order, drops unreferenced ones */
+    static void optimize_vertex_fetch(std::vector<unsigned int>& indices, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals);
+
+    /** Average cache miss ratio: transformed vertices per triangle */
+    static float compute_acmr(const std::vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size);
+
+   private:
+    static int get_next_vertex(size_t num_vertices, unsigned int& cursor, unsigned int cache_size, const std::vector<unsigned int>& candidates, const std::vector<unsigned int>& live_triangles,
+                               const std::vector<unsigned int>& cache_time, unsigned int time, std::vector<unsigned int>& dead_end);
+    static std::vector<unsigned int> find_clusters(const std::vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size, float threshold);
+    static unsigned int count_misses(const std::vector<unsigned int>& indices, size_t first_triangle, size_t last_triangle, std::vector<unsigned int>& cache_time, unsigned int& time, unsigned int cache_size);
+};
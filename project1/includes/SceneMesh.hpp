@@ -13,6 +13,9 @@
 
 #define ASSIMP_PROCESSING_FLAGS aiProcess_JoinIdenticalVertices | aiProcess_Triangulate | aiProcess_GenBoundingBoxes
 
+// Reorder triangles and vertices for the vertex cache and overdraw after loading
+#define OPTIMIZE_MESHES true
+
 /** Single mesh data class */
 struct Mesh {
     unsigned int VAO, VBO1, VBO2, EBO;
@@ -69,6 +72,7 @@ class SceneMesh {
     // Load methods
     void load_model();
     void update_scene_bound_box(aiAABB bound_box);
+    void optimize_mesh(unsigned int index);
     void set_buffer_data(unsigned int index);
     void update_transformation();
 };
\ No newline at end of file
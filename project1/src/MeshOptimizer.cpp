@@ -0,0 +1,241 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+using namespace glm;
+
+void MeshOptimizer::optimize_vertex_cache(vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size) {
+    size_t num_triangles = indices.size() / 3;
+    if (num_triangles == 0) {
+        return;
+    }
+
+    // Vertex-triangle adjacency (offsets into a flat list)
+    vector<unsigned int> live_triangles(num_vertices, 0);
+    for (unsigned int v : indices) {
+        live_triangles[v]++;
+    }
+    vector<unsigned int> offsets(num_vertices + 1, 0);
+    for (size_t v = 0; v < num_vertices; v++) {
+        offsets[v + 1] = offsets[v] + live_triangles[v];
+    }
+    vector<unsigned int> adjacency(indices.size());
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    vector<unsigned int> cache_time(num_vertices, 0);
+    vector<bool> emitted(num_triangles, false);
+    vector<unsigned int> dead_end;
+    vector<unsigned int> candidates;
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    unsigned int time = cache_size + 1;
+    unsigned int cursor = 0;
+    int fanning = 0;
+
+    while (fanning >= 0) {
+        // Emit every triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live_triangles[v]--;
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        fanning = get_next_vertex(num_vertices, cursor, cache_size, candidates, live_triangles, cache_time, time, dead_end);
+    }
+
+    indices = result;
+}
+
+int MeshOptimizer::get_next_vertex(size_t num_vertices, unsigned int& cursor, unsigned int cache_size, const vector<unsigned int>& candidates, const vector<unsigned int>& live_triangles,
+                                   const vector<unsigned int>& cache_time, unsigned int time, vector<unsigned int>& dead_end) {
+    // Prefer the candidate that entered the cache earliest and stays in it while its triangles are emitted
+    int best = -1;
+    int best_priority = -1;
+    for (unsigned int v : candidates) {
+        if (live_triangles[v] == 0) {
+            continue;
+        }
+        int priority = 0;
+        if (time - cache_time[v] + 2 * live_triangles[v] <= cache_size) {
+            priority = time - cache_time[v];
+        }
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+    if (best >= 0) {
+        return best;
+    }
+
+    // Dead end: most recently used vertices first, then the next vertex in input order
+    while (!dead_end.empty()) {
+        unsigned int v = dead_end.back();
+        dead_end.pop_back();
+        if (live_triangles[v] > 0) {
+            return v;
+        }
+    }
+    for (; cursor < num_vertices; cursor++) {
+        if (live_triangles[cursor] > 0) {
+            return cursor;
+        }
+    }
+    return -1;
+}
+
+void MeshOptimizer::optimize_overdraw(vector<unsigned int>& indices, const vector<vec3>& positions, unsigned int cache_size, float threshold) {
+    size_t num_triangles = indices.size() / 3;
+    if (num_triangles == 0) {
+        return;
+    }
+
+    vector<unsigned int> clusters = find_clusters(indices, positions.size(), cache_size, threshold);
+    size_t num_clusters = clusters.size() - 1;
+
+    // Area weighted centroid and normal of each cluster
+    vector<vec3> cluster_centroid(num_clusters, vec3{ 0.0f });
+    vector<vec3> cluster_normal(num_clusters, vec3{ 0.0f });
+    vec3 mesh_centroid{ 0.0f };
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c < num_clusters; c++) {
+        float cluster_area = 0.0f;
+        for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++) {
+            vec3 p0 = positions[indices[t * 3]];
+            vec3 p1 = positions[indices[t * 3 + 1]];
+            vec3 p2 = positions[indices[t * 3 + 2]];
+            vec3 normal = cross(p1 - p0, p2 - p0);
+            float area = length(normal);
+            cluster_centroid[c] += (p0 + p1 + p2) / 3.0f * area;
+            cluster_normal[c] += normal;
+            cluster_area += area;
+        }
+        mesh_centroid += cluster_centroid[c];
+        mesh_area += cluster_area;
+        if (cluster_area > 0.0f) {
+            cluster_centroid[c] /= cluster_area;
+        }
+    }
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= mesh_area;
+    }
+
+    // Clusters facing away from the mesh center are likely to occlude the others
+    vector<float> sort_key(num_clusters);
+    for (size_t c = 0; c < num_clusters; c++) {
+        float normal_length = length(cluster_normal[c]);
+        vec3 normal = normal_length > 0.0f ? cluster_normal[c] / normal_length : vec3{ 0.0f };
+        sort_key[c] = dot(cluster_centroid[c] - mesh_centroid, normal);
+    }
+    vector<unsigned int> order(num_clusters);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sort_key[a] > sort_key[b]; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order) {
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    indices = result;
+}
+
+vector<unsigned int> MeshOptimizer::find_clusters(const vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size, float threshold) {
+    size_t num_triangles = indices.size() / 3;
+    vector<unsigned int> cache_time(num_vertices, 0);
+    unsigned int time = cache_size + 1;
+
+    // Hard boundaries: all three vertices miss, the optimizer jumped to a new region
+    vector<unsigned int> hard;
+    for (size_t t = 0; t < num_triangles; t++) {
+        if (count_misses(indices, t, t + 1, cache_time, time, cache_size) == 3 || t == 0) {
+            hard.push_back((unsigned int)t);
+        }
+    }
+    hard.push_back((unsigned int)num_triangles);
+
+    // Soft boundaries: split a cluster once its prefix reaches the cluster ACMR (relaxed by the threshold)
+    vector<unsigned int> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        time += cache_size + 1;
+        float cluster_acmr = (float)count_misses(indices, hard[h], hard[h + 1], cache_time, time, cache_size) / (hard[h + 1] - hard[h]);
+
+        unsigned int start = hard[h];
+        unsigned int misses = 0;
+        time += cache_size + 1;
+        clusters.push_back(start);
+        for (unsigned int t = hard[h]; t < hard[h + 1]; t++) {
+            misses += count_misses(indices, t, t + 1, cache_time, time, cache_size);
+            if (t + 1 < hard[h + 1] && (float)misses / (t + 1 - start) <= cluster_acmr * threshold) {
+                start = t + 1;
+                misses = 0;
+                time += cache_size + 1;
+                clusters.push_back(start);
+            }
+        }
+    }
+    clusters.push_back((unsigned int)num_triangles);
+    return clusters;
+}
+
+unsigned int MeshOptimizer::count_misses(const vector<unsigned int>& indices, size_t first_triangle, size_t last_triangle, vector<unsigned int>& cache_time, unsigned int& time, unsigned int cache_size) {
+    // FIFO cache: a vertex stays cached for the next cache_size misses
+    unsigned int misses = 0;
+    for (size_t i = first_triangle * 3; i < last_triangle * 3; i++) {
+        unsigned int v = indices[i];
+        if (time - cache_time[v] > cache_size) {
+            cache_time[v] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+void MeshOptimizer::optimize_vertex_fetch(vector<unsigned int>& indices, vector<vec3>& positions, vector<vec3>& normals) {
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(positions.size(), unused);
+    vector<vec3> new_positions;
+    vector<vec3> new_normals;
+    new_positions.reserve(positions.size());
+    new_normals.reserve(normals.size());
+
+    for (unsigned int& v : indices) {
+        if (remap[v] == unused) {
+            remap[v] = (unsigned int)new_positions.size();
+            new_positions.push_back(positions[v]);
+            new_normals.push_back(normals[v]);
+        }
+        v = remap[v];
+    }
+
+    positions = new_positions;
+    normals = new_normals;
+}
+
+float MeshOptimizer::compute_acmr(const vector<unsigned int>& indices, size_t num_vertices, unsigned int cache_size) {
+    size_t num_triangles = indices.size() / 3;
+    if (num_triangles == 0) {
+        return 0.0f;
+    }
+    vector<unsigned int> cache_time(num_vertices, 0);
+    unsigned int time = cache_size + 1;
+    return (float)count_misses(indices, 0, num_triangles, cache_time, time, cache_size) / num_triangles;
+}
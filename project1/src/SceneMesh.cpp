@@ -1,4 +1,5 @@
 #include "SceneMesh.hpp"
+#include "MeshOptimizer.hpp"
 
 #include <GL/glew.h>
 
@@ -73,6 +74,9 @@ void SceneMesh::load_model() {
                 for (unsigned int i4 = 0; i4 < mesh->mFaces[i3].mNumIndices; ++i4)
                     mesh_list[i].vert_indices.push_back(mesh->mFaces[i3].mIndices[i4]);
 
+            if (OPTIMIZE_MESHES)
+                optimize_mesh(i);
+
             set_buffer_data(i);   // Set up: VAO, VBO and EBO.
         }
 
@@ -90,6 +94,19 @@ void SceneMesh::update_scene_bound_box(aiAABB bound_box) {
     bound_box_min.z = std::min(bound_box_min.z, (float)bound_box.mMin.z);
 }
 
+void SceneMesh::optimize_mesh(unsigned int index) {
+    Mesh& mesh = mesh_list[index];
+    float acmr_before = MeshOptimizer::compute_acmr(mesh.vert_indices, mesh.vert_positions.size(), VERTEX_CACHE_SIZE);
+
+    // Overdraw clusters are built from the cache order, fetch order follows the final triangle order
+    MeshOptimizer::optimize_vertex_cache(mesh.vert_indices, mesh.vert_positions.size(), VERTEX_CACHE_SIZE);
+    MeshOptimizer::optimize_overdraw(mesh.vert_indices, mesh.vert_positions, VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+    MeshOptimizer::optimize_vertex_fetch(mesh.vert_indices, mesh.vert_positions, mesh.vert_normals);
+
+    float acmr_after = MeshOptimizer::compute_acmr(mesh.vert_indices, mesh.vert_positions.size(), VERTEX_CACHE_SIZE);
+    cout << "Mesh " << index << " ACMR: " << acmr_before << " -> " << acmr_after << endl;
+}
+
 void SceneMesh::set_buffer_data(unsigned int index) {
     glGenVertexArrays(1, &mesh_list[index].VAO);
     glGenBuffers(1, &mesh_list[index].VBO1);   // Alternative to using 3 separate VBOs, instead use only 1 VBO and set glVertexAttribPointer's offset...
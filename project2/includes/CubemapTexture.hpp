@@ -1,14 +1,24 @@
 #pragma once
 
+#include <chrono>
+#include <future>
 #include <iostream>
 
 class CubemapTexture {
    public:
     CubemapTexture(const std::string text_file, const std::string normal_map_file, bool is_flat);
+    ~CubemapTexture();
 
+    void decode();
+    bool update();
     void load();
     void use();
     bool hasNormalMap();
+    bool isFlat();
+    bool isReady();
+    /** The image could not be read or decoded, the texture never becomes ready */
+    bool hasFailed();
+    size_t getByteSize();
 
    private:
     class Texture {
@@ -17,10 +27,36 @@ class CubemapTexture {
         int face_height;
         int n_channels;
 
+        int im_width;
+        int im_height;
+
+        /** Layout of the pixels uploaded from the pixel buffer */
+        unsigned int internal_format;
         unsigned int color_format;
+        unsigned int color_type;
+        int pixel_size;
+
         unsigned int id;
+        unsigned int target;
 
         std::string filename;
+        bool is_normal_map;
+
+        /** Streaming state */
+        short state;
+        bool compress;
+        bool atlas_layout;
+
+        /** Pixel buffer the worker thread decodes into */
+        unsigned int pbo;
+        unsigned char* pbo_data;
+        size_t pbo_size;
+
+        /** Image decoding running on a worker thread */
+        std::future<bool> decoding;
+
+        /** Signals when the GPU finished reading the pixel buffer (GLsync) */
+        void* upload_fence;
     };
 
     Texture* diffuse_map;
@@ -28,13 +64,27 @@ class CubemapTexture {
 
     bool is_flat;
 
-    static bool loadFlat(Texture* texture);
-    static unsigned char* loadFace(Texture* texture);
+    std::chrono::steady_clock::time_point load_start;
+
+    /** allow_compress false forces the uncompressed path (fallback when the .ktx cache cannot be built) */
+    static void startDecoding(Texture* texture, bool is_cube, bool allow_compress = true);
+    static bool decodeImage(Texture* texture, bool is_cube);
+    static bool decodeCompressed(Texture* texture, bool is_cube);
+    static bool readImageInfo(Texture* texture, bool is_cube);
+
+    bool updateTexture(Texture* texture);
+    void waitTexture(Texture* texture);
+    static void releaseTexture(Texture* texture);
+    static size_t getTextureByteSize(Texture* texture);
+
+    static void allocateStorage(Texture* texture);
+    static void uploadFlat(Texture* texture);
+    static void uploadCube(Texture* texture);
+    static void uploadCompressed(Texture* texture);
 
-    static bool loadCube(Texture* texture);
-    static unsigned char** loadFaces(Texture* texture);
-    static void copyFaceToBuffer(unsigned char* data, int im_w, int f_h, int f_w, int n_c, int f_y, int f_x, unsigned char* buf);
+    static void convertRegion(Texture* texture, unsigned char* im_data, int x, int y, int width, int height, unsigned char* dst);
+    static bool hasUnpackSubimage();
 
-    static void setTexParameters();
-    static void updateColorFormat(Texture* texture);
+    static void setTexParameters(unsigned int target);
+    static void updateUploadFormat(Texture* texture);
 };
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+/** KTX 1.1 container holding block-compressed images (2D or cubemap) */
+class KtxFile {
+   public:
+    unsigned int internal_format;
+    unsigned int base_internal_format;
+
+    int width;
+    int height;
+    int num_faces;
+    int num_levels;
+
+    /** Image data, indexed by level * num_faces + face */
+    std::vector<std::vector<unsigned char>> images;
+
+    /** Key/value metadata, values stored NUL terminated */
+    std::map<std::string, std::string> key_values;
+
+    KtxFile();
+
+    bool read(const std::string filename);
+    bool write(const std::string filename) const;
+
+    const std::vector<unsigned char>& getImage(int level, int face) const;
+    size_t getByteSize() const;
+};
@@ -2,9 +2,13 @@
 
 #include <glm/glm.hpp>
 
+#include "SceneGraph.hpp"
 #include "SceneMesh.hpp"
 #include "Shader.hpp"
 #include "CubemapTexture.hpp"
+#include "OcclusionCuller.hpp"
+#include "bvh.h"
+#include "TextureManager.hpp"
 
 class MeshViewer {
    private:
@@ -23,12 +27,16 @@ class MeshViewer {
     short transform_mode;
     short polygon_mode;
     short color_mode;
+    bool occlusion_culling;
 
     /** Shaders */
     std::vector<Shader*> shaders;
+    std::vector<Shader*> flat_shaders;
 
-    /** Scene mesh */
+    /** Scene mesh, drawn through the scene graph */
     SceneMesh scene_mesh;
+    SceneGraph scene_graph;
+    unsigned int mesh_node;
     float translation_proportion;
 
     /** Camera */
@@ -45,12 +53,26 @@ class MeshViewer {
     glm::vec3 default_object_color;
 
     /** Texture */
+    TextureManager texture_manager;
+    std::vector<std::pair<std::string, std::string>> material_sets;
+    unsigned int material_index;
+    /** Shown again when the current material fails to load */
+    unsigned int previous_material_index;
     CubemapTexture* texture;
 
     /** Projection */
     float projection_fovy;
     float projection_near;
 
+    /** Picking, triangles in model space */
+    TriangleBVH bvh;
+
+    /** Occlusion culling */
+    OcclusionCuller occlusion_culler;
+    std::vector<const Mesh*> cull_meshes;
+    std::vector<glm::mat4> cull_matrices;
+    std::vector<bool> mesh_visible;
+
     /** MVP Matrices */
     glm::mat4 model;
     glm::mat4 view;
@@ -66,6 +88,7 @@ class MeshViewer {
     void _reshape(int width, int height);
     void _keyboard(unsigned char key, int x, int y);
     void _specialKeys(int key, int x, int y);
+    void _mouse(int button, int state, int x, int y);
     void _idle();
 
    private:
@@ -74,16 +97,25 @@ class MeshViewer {
     void initAttributes();
 
     void loadResources(const std::string mesh_file, const std::string texture_file, const std::string normal_map_file);
+    void findMaterialSets(const std::string texture_file, const std::string normal_map_file);
 
     void fitViewProjection();
 
+    void renderSoftware(const std::string mesh_file, const std::string texture_file, const std::string normal_map_file, const std::string output_file, int num_frames);
+
+    Shader* getShader(unsigned short mode);
+
     void bindLightMode(Shader* shader);
     void bindTextMode(Shader* shader);
     void bindTextNormalMode(Shader* shader);
 
     // Control methods
     void changeColorMode(unsigned short mode);
+    void changeMaterial(int step);
+    void removeMaterial(unsigned int index);
     void switchPolygonMode();
+    void switchOcclusionCulling();
+    void pick(int x, int y);
     void transformMesh(unsigned short key);
     void translateMesh(unsigned short key);
     void rotateMesh(unsigned short key);
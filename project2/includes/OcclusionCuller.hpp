@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "SceneMesh.hpp"
+#include "clipspace.h"
+#include "halfspace.h"
+
+// Occlusion depth buffer size (width a multiple of 8)
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+
+/**
+ * CPU occlusion culling. Meshes covering a large part of the screen are
+ * rasterized as occluders into a small depth buffer, then every mesh's
+ * bounding box is tested against a max-depth mip chain of that buffer.
+ */
+class OcclusionCuller {
+   public:
+    OcclusionCuller();
+
+    /**
+     * Meshes of every model with their own matrices, all occluders are rasterized before any box is tested.
+     * One flag per mesh, false for the meshes hidden behind the occluders (or off screen)
+     */
+    void cull(const std::vector<const Mesh*>& meshes, const std::vector<glm::mat4>& model_view_projections, std::vector<bool>* visible);
+
+    // Statistics of the last frame
+    unsigned int getNumOccluders() const;
+    unsigned int getNumCulled() const;
+    double getCostMs() const;
+
+   private:
+    /** Level 0 is the depth buffer (dilated), each level keeps the max of 2x2 texels */
+    std::vector<std::vector<float>> levels;
+    std::vector<float> depth;
+    std::vector<float> dilated;
+
+    std::vector<ClipVertex> vertices;
+    std::vector<RasterBlock> blocks;
+    TriangleClipper clipper;
+
+    unsigned int num_occluders;
+    unsigned int num_culled;
+    double cost_ms;
+
+    bool projectBox(glm::vec3 box_min, glm::vec3 box_max, const glm::mat4& model_view_projection, glm::ivec4* rect, float* min_depth) const;
+    void rasterizeOccluder(const Mesh& mesh, const glm::mat4& model_view_projection);
+    void buildLevels();
+    bool isOccluded(glm::ivec4 rect, float min_depth) const;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Pixel format conversions run on decoded images before upload.
+ * Uses SSSE3 byte shuffles when available, with scalar fallbacks.
+ */
+class PixelConverter {
+   public:
+    /** Any 1 to 4 channel image to BGRA, the layout drivers upload without repacking */
+    static void toBGRA(const unsigned char* src, int n_channels, unsigned char* dst, size_t num_pixels);
+
+    static void expandRGBToBGRA(const unsigned char* src, unsigned char* dst, size_t num_pixels);
+    static void swizzleRGBAToBGRA(const unsigned char* src, unsigned char* dst, size_t num_pixels);
+
+    /** Rescales the first three channels to unit vectors, so Z can be rebuilt from X and Y */
+    static void normalizeVectors(unsigned char* data, int n_channels, size_t num_pixels);
+
+    /** Keeps the first two channels (X and Y of normal maps) */
+    static void extractRG(const unsigned char* src, int n_channels, unsigned char* dst, size_t num_pixels);
+
+    /** In place, alpha (4th channel) is left untouched */
+    static void srgbToLinear(unsigned char* data, int n_channels, size_t num_pixels);
+};
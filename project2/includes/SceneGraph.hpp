@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "SceneMesh.hpp"
+
+// Parent index of the root nodes
+#define NO_PARENT -1
+
+/**
+ * Hierarchy of transforms, nodes optionally drawing a SceneMesh.
+ * Nodes are stored as parallel arrays in topological order (parents before
+ * their children), so update() is one linear pass recomputing the world
+ * matrices of the changed nodes and their subtrees only.
+ */
+class SceneGraph {
+   public:
+    SceneGraph();
+
+    /** Appended after its parent, mesh is not owned (nullptr for a group) */
+    unsigned int addNode(int parent, const glm::mat4& local, SceneMesh* mesh = nullptr);
+    void clear();
+
+    void setLocalTransform(unsigned int node, const glm::mat4& local);
+    void update();
+
+    unsigned int getNumNodes() const;
+    int getParent(unsigned int node) const;
+    SceneMesh* getMesh(unsigned int node) const;
+    const glm::mat4& getLocalTransform(unsigned int node) const;
+    const glm::mat4& getWorldTransform(unsigned int node) const;
+
+    /** World matrices recomputed by the last update */
+    unsigned int getNumUpdated() const;
+
+   private:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<SceneMesh*> meshes;
+    std::vector<unsigned char> dirty;
+
+    bool any_dirty;
+    unsigned int num_updated;
+};
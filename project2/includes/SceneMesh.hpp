@@ -11,6 +11,8 @@
 #include <glm/glm.hpp>
 #include <vector>
 
+class TriangleBVH;
+
 /** Single mesh data class */
 class Mesh {
    public:
@@ -18,10 +20,12 @@ class Mesh {
 
     std::vector<glm::vec3> vert_positions;
     std::vector<glm::vec3> vert_normals;
-    std::vector<glm::vec3> vert_tangents;
+    std::vector<glm::vec4> vert_tangents;
     std::vector<unsigned int> vert_indices;
 
     glm::vec3 center;
+    glm::vec3 bound_box_max;
+    glm::vec3 bound_box_min;
 };
 
 class SceneMesh {
@@ -37,6 +41,16 @@ class SceneMesh {
     glm::vec3 bound_box_max;
     glm::vec3 bound_box_min;
 
+    // Bounding boxes after the transformation, refit on demand
+    mutable bool bounds_dirty;
+    mutable glm::vec3 transformed_box_max;
+    mutable glm::vec3 transformed_box_min;
+    mutable std::vector<glm::vec3> mesh_box_max;
+    mutable std::vector<glm::vec3> mesh_box_min;
+
+    // Rotation pivot in model space, the center unless set
+    glm::vec3 pivot;
+
     // Transformation parameters
     glm::vec3 _translation;
     glm::vec3 _rotation;
@@ -51,26 +65,35 @@ class SceneMesh {
    public:
     SceneMesh();
 
-    void load(const std::string mesh_path);
+    /** Without upload_buffers the mesh stays on the CPU (no GL context needed) */
+    void load(const std::string mesh_path, bool upload_buffers = true);
 
     // Transformation
     void translate(glm::vec3 translation);
     void rotate(float degrees, glm::vec3 axis);
     void scale(glm::vec3 scale);
+    void setPivot(glm::vec3 pivot);
 
     // Getters
     unsigned int getNumMeshes() const;
-    std::vector<Mesh> getMeshList() const;
+    const std::vector<Mesh>& getMeshList() const;
     glm::vec3 getCenter() const;
+    glm::vec3 getPivot() const;
+    /** Scene bounds after the transformation */
     glm::vec3 getBoundBoxMax() const;
     glm::vec3 getBoundBoxMin() const;
+    void getMeshBoundBox(unsigned int index, glm::vec3* box_min, glm::vec3* box_max) const;
     glm::mat4 getTransformation() const;
 
+    /** Every mesh's triangles, in model space (rays go through the inverse transformation) */
+    void buildBVH(TriangleBVH* bvh, int num_threads) const;
+
    private:
     // Load methods
-    void loadModel();
+    void loadModel(bool upload_buffers);
     void setBufferData(unsigned int index);
     void calcTangentSpace(unsigned int index);
 
     void updateTransformation();
+    void refitBounds() const;
 };
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "SceneMesh.hpp"
+#include "clipspace.h"
+#include "halfspace.h"
+
+// Color modes, shared with MeshViewer
+#define LIGHTNING_MODE 0
+#define TEXTURE_MODE 1
+#define TEXTURE_NORMAL_MODE 2
+
+// Screen tiles rasterized by one worker at a time, in pixels
+#define TILE_SIZE 64
+
+/** Uniforms of the light, text and normal shaders */
+struct ShadingParams {
+    short color_mode;
+
+    glm::mat4 model;
+    glm::mat4 view;
+    glm::mat4 projection;
+
+    glm::vec3 light_color;
+    glm::vec3 light_position;
+    glm::vec3 camera_position;
+
+    glm::vec3 object_color;
+    glm::vec3 object_center;
+    glm::vec3 background_color;
+};
+
+/**
+ * CPU version of the MeshViewer pipeline, for machines without a GPU.
+ * Triangles are transformed, clipped and binned to screen tiles in parallel,
+ * then worker threads rasterize and shade one tile (and its depth buffer) at a time.
+ */
+class SoftwareRenderer {
+   public:
+    SoftwareRenderer(int width, int height, int num_threads);
+
+    /** Same images as CubemapTexture: a 4x3 cube atlas, or a flat image projected on the cube faces */
+    void loadMaterial(const std::string text_file, const std::string normal_map_file, bool is_flat);
+    bool hasNormalMap() const;
+
+    void render(const std::vector<Mesh>& meshes, const ShadingParams& params);
+
+    /** .ppm or .png, chosen by the extension */
+    bool writeImage(const std::string filename) const;
+
+    // Statistics of the last frame
+    size_t getNumTriangles() const;
+    size_t getNumRasterized() const;
+
+   private:
+    /** RGB8 image, first row at the top */
+    class Image {
+       public:
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    /** Clipped triangle set up for rasterization, attributes are divided by w */
+    class Triangle {
+       public:
+        HalfSpaceTriangle edges;
+        float inv_w[3];
+        float attributes[3][CLIP_MAX_ATTRIBUTES];
+    };
+
+    class Tile {
+       public:
+        int x, y;
+        int width, height;
+        std::vector<unsigned char> color;
+        std::vector<float> depth;
+    };
+
+    int width;
+    int height;
+    int num_threads;
+
+    int tiles_x;
+    int tiles_y;
+    std::vector<Tile> tiles;
+
+    /** Per thread triangles and tile bins, so binning needs no locks */
+    std::vector<std::vector<Triangle>> triangles;
+    std::vector<std::vector<std::vector<unsigned int>>> bins;
+    /** Triangles per thread after each mesh, to replay the bins mesh by mesh */
+    std::vector<std::vector<unsigned int>> mesh_ends;
+
+    std::vector<ClipVertex> vertices;
+    TriangleClipper clipper;
+    int num_attributes;
+
+    Image diffuse_map;
+    Image normal_map;
+    std::vector<Image> diffuse_faces;
+    std::vector<Image> normal_faces;
+    bool is_flat;
+    bool has_normal_map;
+
+    size_t num_triangles;
+
+    void transformVertices(const Mesh& mesh, const ShadingParams& params, size_t first, size_t last);
+    void binTriangles(const Mesh& mesh, size_t first, size_t last, int thread);
+    void setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int thread);
+
+    void rasterizeTile(Tile& tile, const ShadingParams& params);
+    void rasterizeTriangle(const Triangle& triangle, Tile& tile, const ShadingParams& params, std::vector<RasterBlock>& blocks);
+    glm::vec3 shade(const float* attributes, const ShadingParams& params) const;
+
+    glm::vec3 sampleCube(const std::vector<Image>& faces, const Image& flat, glm::vec3 dir) const;
+    static glm::vec3 sampleBilinear(const Image& image, float u, float v);
+    static bool loadImage(const std::string filename, bool is_normal_map, bool is_cube, Image* image, std::vector<Image>* faces);
+
+    bool writePPM(const std::string filename, const std::vector<unsigned char>& rgb) const;
+    bool writePNG(const std::string filename, const std::vector<unsigned char>& rgb) const;
+
+    void parallelFor(size_t count, const std::function<void(size_t, size_t, int)>& task) const;
+};
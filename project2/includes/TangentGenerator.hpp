@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * Per vertex tangents for indexed meshes textured by cube projection.
+ * Vertices are split only where the triangles sharing them use a different
+ * cube face or UV handedness, tangents are accumulated in parallel.
+ */
+class TangentGenerator {
+   public:
+    /** Splits seam vertices in place, tangent w holds the bitangent sign */
+    static void generate(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, glm::vec3 center, std::vector<glm::vec4>* tangents);
+
+   private:
+    static void computeTriangleFrames(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, glm::vec3 center, size_t first, size_t last,
+                                      std::vector<glm::vec3>& triangle_tangents, std::vector<unsigned char>& triangle_keys);
+    static void splitSeams(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<unsigned int>& indices, const std::vector<unsigned char>& triangle_keys);
+    static void accumulate(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& triangle_tangents,
+                           size_t first, size_t last, std::vector<glm::vec3>& sums);
+    static glm::vec3 orthogonalize(glm::vec3 tangent, glm::vec3 normal);
+
+    static void parallelFor(size_t count, const std::function<void(size_t, size_t, int)>& task);
+    static int numThreads(size_t count);
+};
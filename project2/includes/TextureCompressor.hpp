@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "KtxFile.hpp"
+
+// Stored in the .ktx key/value data, bump when the encoder output changes to rebuild old caches
+#define TEXTURE_ENCODER_KEY "TextureCompressorVersion"
+#define TEXTURE_ENCODER_VERSION "2"
+
+// Position (x, y) of each cubemap face in the 4x3 atlas, in face units
+extern const int cube_face_offsets[6][2];
+
+/**
+ * Block compression of texture images into .ktx files.
+ * Diffuse maps are encoded as BC1 (DXT1) and normal maps as BC5 (RGTC2, X and Y only).
+ */
+class TextureCompressor {
+   public:
+    static bool loadCached(const std::string filename, bool is_cube, bool is_normal_map, KtxFile* ktx);
+    static bool encode(const std::string filename, bool is_cube, bool is_normal_map, KtxFile* ktx);
+
+    static std::string cachePath(const std::string filename);
+
+    static int numLevels(int width, int height);
+    static size_t compressedSize(int width, int height, int num_faces, bool is_normal_map);
+    static unsigned int compressedFormat(bool is_normal_map);
+    static unsigned int compressedImageSize(int width, int height, bool is_normal_map);
+
+   private:
+    static bool isCacheValid(const std::string filename, const KtxFile& ktx);
+
+    static void compressImage(const unsigned char* rgba, int width, int height, bool is_normal_map, std::vector<unsigned char>* out);
+    static void compressBC1Block(const unsigned char* block, unsigned char* out);
+    static void compressBC4Block(const unsigned char* block, int channel, unsigned char* out);
+
+    static void fetchBlock(const unsigned char* rgba, int width, int height, int block_x, int block_y, unsigned char* block);
+    static std::vector<unsigned char> downsample(const std::vector<unsigned char>& rgba, int width, int height);
+};
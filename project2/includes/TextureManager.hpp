@@ -0,0 +1,47 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "CubemapTexture.hpp"
+
+/**
+ * Keeps loaded textures resident within a GPU memory budget.
+ * Textures are looked up by file name and the least recently used ones are evicted first.
+ */
+class TextureManager {
+   public:
+    TextureManager();
+    ~TextureManager();
+
+    /** NULL when the texture files cannot be read or failed to decode */
+    CubemapTexture* get(const std::string text_file, const std::string normal_map_file);
+    void update();
+
+    void setBudget(size_t budget_bytes);
+    size_t getResidentBytes() const;
+    void printStats() const;
+
+   private:
+    class Entry {
+       public:
+        std::string key;
+        CubemapTexture* texture;
+        size_t byte_size;
+    };
+
+    /** Most recently used first */
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> lookup;
+
+    size_t budget_bytes;
+    size_t resident_bytes;
+
+    /** Counters */
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+
+    void enforceBudget();
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -9,7 +10,7 @@ using namespace std;
 using namespace glm;
 
 // Based on: https://en.wikipedia.org/wiki/Cube_mapping
-glm::vec2 toCubeUV(vec3 pos, vec3 normal) {
+inline glm::vec2 toCubeUV(vec3 pos, vec3 normal) {
     vec3 cube = normalize(pos);
     vec3 abs_c = abs(cube);
     vec3 abs_n = abs(normal);
@@ -124,6 +125,75 @@ glm::vec2 toCubeUV(vec3 pos, vec3 normal) {
     return vec2{ u, v };
 }
 
-glm::vec3 toVec3(aiVector3D ai_vec3) {
+// Cube face of a direction: +X, -X, +Y, -Y, +Z, -Z
+inline int cubeFace(vec3 dir) {
+    vec3 abs_d = abs(dir);
+    if (abs_d.x >= abs_d.y && abs_d.x >= abs_d.z) {
+        return dir.x > 0 ? 0 : 1;
+    }
+    if (abs_d.y >= abs_d.z) {
+        return dir.y > 0 ? 2 : 3;
+    }
+    return dir.z > 0 ? 4 : 5;
+}
+
+// Projection of a direction on a given face, same orientation as toCubeUV
+inline glm::vec2 cubeFaceUV(vec3 dir, int face) {
+    float max_axis, uc, vc;
+    switch (face) {
+        case 0:
+            max_axis = dir.x;
+            uc = -dir.z;
+            vc = dir.y;
+            break;
+        case 1:
+            max_axis = -dir.x;
+            uc = dir.z;
+            vc = dir.y;
+            break;
+        case 2:
+            max_axis = dir.y;
+            uc = dir.x;
+            vc = -dir.z;
+            break;
+        case 3:
+            max_axis = -dir.y;
+            uc = dir.x;
+            vc = dir.z;
+            break;
+        case 4:
+            max_axis = dir.z;
+            uc = dir.x;
+            vc = dir.y;
+            break;
+        default:
+            max_axis = -dir.z;
+            uc = -dir.x;
+            vc = dir.y;
+            break;
+    }
+
+    // Points behind the face plane are clamped instead of mirrored
+    max_axis = std::max(max_axis, 1e-6f);
+    float u = 0.5f * (uc / max_axis + 1.0f);
+    float v = 0.5f * (vc / max_axis + 1.0f);
+    return vec2{ u, v };
+}
+
+inline glm::vec3 toVec3(aiVector3D ai_vec3) {
     return vec3{ (float)ai_vec3.x, (float)ai_vec3.y, (float)ai_vec3.z };
 }
+
+// Arvo, "Transforming Axis-Aligned Bounding Boxes" (Graphics Gems, 1990): no corners needed
+inline void transformBoundBox(const mat4& m, vec3 box_min, vec3 box_max, vec3* out_min, vec3* out_max) {
+    vec3 lo = vec3(m[3]);
+    vec3 hi = lo;
+    for (int j = 0; j < 3; j++) {
+        vec3 a = vec3(m[j]) * box_min[j];
+        vec3 b = vec3(m[j]) * box_max[j];
+        lo += glm::min(a, b);
+        hi += glm::max(a, b);
+    }
+    *out_min = lo;
+    *out_max = hi;
+}
@@ -0,0 +1,79 @@
+#version 330 core
+
+out vec4 fragColor;
+
+in VS_OUT {
+    vec3 frag_pos;
+	vec3 tan_light_pos;
+	vec3 tan_camera_pos;
+	vec3 tan_frag_pos;
+} fs_in;
+
+uniform sampler2D diffuse_map;
+uniform sampler2D normal_map;
+
+uniform vec3 light_color;
+uniform vec3 object_center;
+
+// Shared with text_flat_frag.glsl and normal_flat_frag.glsl, keep both copies identical.
+
+// Face coordinates (s, t) and major axis (m) of v on the cube face selected by dir,
+// with the same face selection and orientation as OpenGL cube map sampling.
+// Linear in v, so it also maps the screen space derivatives of dir
+vec3 cubeFaceCoord(vec3 dir, vec3 v)
+{
+    vec3 a = abs(dir);
+    if (a.x >= a.y && a.x >= a.z) {
+        return dir.x > 0.0 ? vec3(-v.z, -v.y, v.x) : vec3(v.z, -v.y, -v.x);
+    }
+    if (a.y >= a.z) {
+        return dir.y > 0.0 ? vec3(v.x, v.z, v.y) : vec3(v.x, -v.z, -v.y);
+    }
+    return dir.z > 0.0 ? vec3(v.x, -v.y, v.z) : vec3(-v.x, -v.y, -v.z);
+}
+
+// Samples the flat texture as if it was replicated on the six cube faces.
+// Gradients come from the direction, so mip selection does not jump at face edges,
+// and are projected on the face so oblique views keep their anisotropy.
+vec4 textureFlatCube(sampler2D map, vec3 dir)
+{
+    vec3 c = cubeFaceCoord(dir, dir);
+    vec3 dx = cubeFaceCoord(dir, dFdx(dir));
+    vec3 dy = cubeFaceCoord(dir, dFdy(dir));
+
+    // uv = 0.5 * (st / m + 1), differentiated with the quotient rule
+    vec2 uv = 0.5 * (c.xy / c.z + 1.0);
+    vec2 grad_x = 0.5 * (dx.xy - c.xy / c.z * dx.z) / c.z;
+    vec2 grad_y = 0.5 * (dy.xy - c.xy / c.z * dy.z) / c.z;
+    return textureGrad(map, uv, grad_x, grad_y);
+}
+
+void main()
+{
+    vec3 text_coord = fs_in.frag_pos - object_center;
+    // Only X and Y are stored (BC5 has two channels), Z is rebuilt
+    vec2 normal_xy = textureFlatCube(normal_map, text_coord).rg * 2.0 - 1.0;
+    vec3 normal = vec3(normal_xy, sqrt(max(1.0 - dot(normal_xy, normal_xy), 0.0)));
+    normal.y = -normal.y;
+    vec3 n = normalize(normal);
+    
+    float ka = 0.1;
+    vec3 ambient = ka * light_color;
+
+    float kd = 0.5;
+    vec3 l = normalize(fs_in.tan_light_pos - fs_in.tan_frag_pos);
+
+    float diff = max(dot(n,l), 0.0);
+    vec3 diffuse = kd * diff * light_color;
+
+    float ks = 0.8;
+    vec3 v = normalize(fs_in.tan_camera_pos - fs_in.tan_frag_pos);
+    vec3 r = reflect(-l, n);
+
+    float spec = pow(max(dot(v, r), 0.0), 32);
+    vec3 specular = ks * spec * light_color;
+
+    vec3 color = textureFlatCube(diffuse_map, text_coord).rgb;
+    vec3 light = (ambient + diffuse + specular) * color;
+    fragColor = vec4(light, 1.0);
+}
\ No newline at end of file
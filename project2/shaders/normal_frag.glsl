@@ -18,7 +18,9 @@ uniform vec3 object_center;
 void main()
 {
     vec3 text_coord = fs_in.frag_pos - object_center;
-    vec3 normal = textureCube(normal_map, text_coord).rgb * 2.0 - 1.0;
+    // Only X and Y are stored (BC5 has two channels), Z is rebuilt
+    vec2 normal_xy = textureCube(normal_map, text_coord).rg * 2.0 - 1.0;
+    vec3 normal = vec3(normal_xy, sqrt(max(1.0 - dot(normal_xy, normal_xy), 0.0)));
     normal.y = -normal.y;
     vec3 n = normalize(normal);
     
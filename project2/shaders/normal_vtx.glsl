@@ -2,7 +2,7 @@
 
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec3 aTangent;
+layout(location = 2) in vec4 aTangent;
 
 out VS_OUT {
 	vec3 frag_pos;
@@ -22,10 +22,10 @@ void main() {
 	vs_out.frag_pos = aPos;
 
 	mat3 normal_mat = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normal_mat * aTangent);
+    vec3 T = normalize(normal_mat * aTangent.xyz);
     vec3 N = normalize(normal_mat * aNormal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * aTangent.w;
 	mat3 TBN = transpose(mat3(T, B, N));
 
 	vs_out.tan_light_pos = TBN * light_position;
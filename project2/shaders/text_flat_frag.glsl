@@ -0,0 +1,70 @@
+#version 330 core
+
+in vec3 frag_pos;
+in vec3 normal;
+in vec3 transf_frag_pos;
+
+out vec4 frag_color;
+
+uniform vec3 light_color;
+uniform vec3 light_position;
+uniform vec3 camera_position;
+uniform vec3 object_center;
+uniform sampler2D diffuse_map;
+
+// Shared with text_flat_frag.glsl and normal_flat_frag.glsl, keep both copies identical.
+
+// Face coordinates (s, t) and major axis (m) of v on the cube face selected by dir,
+// with the same face selection and orientation as OpenGL cube map sampling.
+// Linear in v, so it also maps the screen space derivatives of dir
+vec3 cubeFaceCoord(vec3 dir, vec3 v)
+{
+    vec3 a = abs(dir);
+    if (a.x >= a.y && a.x >= a.z) {
+        return dir.x > 0.0 ? vec3(-v.z, -v.y, v.x) : vec3(v.z, -v.y, -v.x);
+    }
+    if (a.y >= a.z) {
+        return dir.y > 0.0 ? vec3(v.x, v.z, v.y) : vec3(v.x, -v.z, -v.y);
+    }
+    return dir.z > 0.0 ? vec3(v.x, -v.y, v.z) : vec3(-v.x, -v.y, -v.z);
+}
+
+// Samples the flat texture as if it was replicated on the six cube faces.
+// Gradients come from the direction, so mip selection does not jump at face edges,
+// and are projected on the face so oblique views keep their anisotropy.
+vec4 textureFlatCube(sampler2D map, vec3 dir)
+{
+    vec3 c = cubeFaceCoord(dir, dir);
+    vec3 dx = cubeFaceCoord(dir, dFdx(dir));
+    vec3 dy = cubeFaceCoord(dir, dFdy(dir));
+
+    // uv = 0.5 * (st / m + 1), differentiated with the quotient rule
+    vec2 uv = 0.5 * (c.xy / c.z + 1.0);
+    vec2 grad_x = 0.5 * (dx.xy - c.xy / c.z * dx.z) / c.z;
+    vec2 grad_y = 0.5 * (dy.xy - c.xy / c.z * dy.z) / c.z;
+    return textureGrad(map, uv, grad_x, grad_y);
+}
+
+void main()
+{
+    float ka = 0.1;
+    vec3 ambient = ka * light_color;
+
+    float kd = 0.5;
+    vec3 n = normalize(normal);
+    vec3 l = normalize(light_position - transf_frag_pos);
+
+    float diff = max(dot(n,l), 0.0);
+    vec3 diffuse = kd * diff * light_color;
+
+    float ks = 0.8;
+    vec3 v = normalize(camera_position - transf_frag_pos);
+    vec3 r = reflect(-l, n);
+
+    float spec = pow(max(dot(v, r), 0.0), 32);
+    vec3 specular = ks * spec * light_color;
+
+    vec3 object_color = textureFlatCube(diffuse_map, frag_pos - object_center).rgb;
+    vec3 light = (ambient + diffuse + specular) * object_color;
+    frag_color = vec4(light, 1.0);
+}
\ No newline at end of file
@@ -1,74 +1,109 @@
 #include "CubemapTexture.hpp"
 #include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 
-#define STB_IMAGE_IMPLEMENTATION
+#include "PixelConverter.hpp"
+#include "TextureCompressor.hpp"
 #include "stb_image.h"
 
 using namespace std;
 
-#define RIGHT_FACE 0
-#define LEFT_FACE 1
-#define TOP_FACE 2
-#define BOTTOM_FACE 3
-#define FRONT_FACE 4
-#define BACK_FACE 5
+// Anisotropic filtering level, clamped to what the driver supports
+#define MAX_ANISOTROPY 8.0f
+
+// Texture streaming states
+#define TEXTURE_IDLE 0
+#define TEXTURE_DECODING 1
+#define TEXTURE_UPLOADING 2
+#define TEXTURE_READY 3
+#define TEXTURE_FAILED 4
+
+// Block-compress textures (BC1/BC5), uncompressed normal maps are stored as RG8
+#define COMPRESS_TEXTURES true
+
+// Blocking wait for an upload fence, in nanoseconds
+#define FENCE_TIMEOUT 1000000000
+
+// Convert uncompressed diffuse maps to linear color on load.
+// The shaders light in gamma space, enable only together with an sRGB framebuffer.
+#define DIFFUSE_SRGB_TO_LINEAR false
 
 CubemapTexture::CubemapTexture(const string text_file, const string normal_map_file, bool is_flat) {
     this->is_flat = is_flat;
     this->diffuse_map = new Texture();
     this->diffuse_map->filename = text_file;
+    this->diffuse_map->is_normal_map = false;
+    this->diffuse_map->state = TEXTURE_IDLE;
 
     ifstream f(normal_map_file.c_str());
     if (f.good()) {
         this->normal_map = new Texture();
         this->normal_map->filename = normal_map_file;
+        this->normal_map->is_normal_map = true;
+        this->normal_map->state = TEXTURE_IDLE;
     } else {
         this->normal_map = NULL;
     }
 }
 
+CubemapTexture::~CubemapTexture() {
+    releaseTexture(this->diffuse_map);
+    delete this->diffuse_map;
+
+    if (hasNormalMap()) {
+        releaseTexture(this->normal_map);
+        delete this->normal_map;
+    }
+}
+
+void CubemapTexture::decode() {
+    load_start = chrono::steady_clock::now();
+
+    startDecoding(this->diffuse_map, !is_flat);
+    if (hasNormalMap()) {
+        startDecoding(this->normal_map, !is_flat);
+    }
+}
+
+bool CubemapTexture::update() {
+    if (isReady()) {
+        return true;
+    }
+
+    updateTexture(this->diffuse_map);
+    if (hasNormalMap()) {
+        updateTexture(this->normal_map);
+    }
+
+    if (isReady()) {
+        // Uploads bind to whatever unit is active, restore the texture units
+        use();
+        return true;
+    }
+    return false;
+}
+
 void CubemapTexture::load() {
-    if (is_flat) {
-        if (loadFlat(this->diffuse_map)) {
-            cout << "Texture " << this->diffuse_map->id << " - Diffuse flat loaded: " << this->diffuse_map->filename << endl;
-        } else {
-            cerr << "Texture " << this->diffuse_map->id << " - Failed to load diffuse flat: " << this->diffuse_map->filename << endl;
-            exit(-1);
-        }
-        if (hasNormalMap()) {
-            if (loadFlat(this->normal_map)) {
-                cout << "Texture " << this->normal_map->id << " - Normal map flat loaded: " << this->normal_map->filename << endl;
-            } else {
-                cerr << "Texture " << this->normal_map->id << " - Failed to load normal map flat: " << this->diffuse_map->filename << endl;
-                exit(-1);
-            }
-        }
-    } else {
-        if (loadCube(this->diffuse_map)) {
-            cout << "Texture " << this->diffuse_map->id << " - Diffuse cube loaded: " << this->diffuse_map->filename << endl;
-        } else {
-            cerr << "Texture " << this->diffuse_map->id << " - Failed to load diffuse cube: " << this->diffuse_map->filename << endl;
-            exit(-1);
-        }
-        if (hasNormalMap()) {
-            if (loadCube(this->normal_map)) {
-                cout << "Texture " << this->normal_map->id << " - Normal map cube loaded: " << this->diffuse_map->filename << endl;
-            } else {
-                cerr << "Texture " << this->normal_map->id << " - Failed to load normal map cube: " << this->diffuse_map->filename << endl;
-                exit(-1);
-            }
-        }
+    if (this->diffuse_map->state == TEXTURE_IDLE) {
+        decode();
     }
+
+    waitTexture(this->diffuse_map);
+    if (hasNormalMap()) {
+        waitTexture(this->normal_map);
+    }
+    use();
 }
 
 void CubemapTexture::use() {
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, this->diffuse_map->id);
+    glBindTexture(this->diffuse_map->target, this->diffuse_map->id);
 
     if (hasNormalMap()) {
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, this->normal_map->id);
+        glBindTexture(this->normal_map->target, this->normal_map->id);
     }
 }
 
@@ -76,156 +111,400 @@ bool CubemapTexture::hasNormalMap() {
     return this->normal_map != NULL;
 }
 
-bool CubemapTexture::loadFlat(Texture* texture) {
+bool CubemapTexture::isFlat() {
+    return this->is_flat;
+}
+
+bool CubemapTexture::isReady() {
+    return this->diffuse_map->state == TEXTURE_READY && (!hasNormalMap() || this->normal_map->state == TEXTURE_READY);
+}
+
+bool CubemapTexture::hasFailed() {
+    return this->diffuse_map->state == TEXTURE_FAILED || (hasNormalMap() && this->normal_map->state == TEXTURE_FAILED);
+}
+
+size_t CubemapTexture::getByteSize() {
+    size_t size = getTextureByteSize(this->diffuse_map);
+    if (hasNormalMap()) {
+        size += getTextureByteSize(this->normal_map);
+    }
+    return size;
+}
+
+void CubemapTexture::startDecoding(Texture* texture, bool is_cube, bool allow_compress) {
+    // BC5 (RGTC) is core, BC1 needs S3TC
+    texture->compress = allow_compress && COMPRESS_TEXTURES && (texture->is_normal_map || GLEW_EXT_texture_compression_s3tc);
+    // Uncompressed cube faces are read from the atlas at upload when the driver allows it
+    texture->atlas_layout = is_cube && !texture->compress && hasUnpackSubimage();
+
+    if (!readImageInfo(texture, is_cube)) {
+        cerr << "Failed to read texture file: " << texture->filename << endl;
+        texture->id = 0;
+        texture->state = TEXTURE_FAILED;
+        return;
+    }
+
     glGenTextures(1, &texture->id);
+    texture->target = is_cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    allocateStorage(texture);
+
+    // Orphaned pixel buffer, mapped for the worker thread to decode into
+    glGenBuffers(1, &texture->pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture->pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, texture->pbo_size, NULL, GL_STREAM_DRAW);
+    texture->pbo_data = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, texture->pbo_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    texture->state = TEXTURE_DECODING;
+    texture->decoding = async(launch::async, decodeImage, texture, is_cube);
+}
 
-    unsigned char* im_data = loadFace(texture);
-    if (im_data) {
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id);
+bool CubemapTexture::readImageInfo(Texture* texture, bool is_cube) {
+    // Only the image header is parsed here, the pixels are decoded on the worker
+    if (!stbi_info(texture->filename.c_str(), &texture->im_width, &texture->im_height, &texture->n_channels)) {
+        return false;
+    }
 
-        for (int i = 0; i < 6; i++) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, texture->face_width, texture->face_height, 0, texture->color_format, GL_UNSIGNED_BYTE, im_data);
+    if (is_cube) {
+        if (texture->im_height % 3 != 0 || texture->im_width % 4 != 0) {
+            cerr << "Texture file " << texture->filename << " size does not match with cubemap" << endl;
+            return false;
         }
-        setTexParameters();
-
-        free(im_data);
-        return true;
+        texture->face_width = texture->im_width / 4;
+        texture->face_height = texture->im_height / 3;
+    } else {
+        texture->face_width = texture->im_width;
+        texture->face_height = texture->im_height;
+    }
 
+    if (texture->compress) {
+        texture->color_format = texture->is_normal_map ? GL_RG : GL_RGB;
+        texture->pbo_size = TextureCompressor::compressedSize(texture->face_width, texture->face_height, is_cube ? 6 : 1, texture->is_normal_map);
     } else {
-        return false;
+        updateUploadFormat(texture);
+        texture->pbo_size = texture->im_width * texture->im_height * texture->pixel_size;
     }
+    return true;
 }
 
-unsigned char* CubemapTexture::loadFace(Texture* texture) {
-    unsigned char* im_data = stbi_load(texture->filename.c_str(), &texture->face_width, &texture->face_height, &texture->n_channels, 0);
+bool CubemapTexture::decodeImage(Texture* texture, bool is_cube) {
+    // Runs on a worker thread: must not touch any GL state
+    if (texture->compress) {
+        return decodeCompressed(texture, is_cube);
+    }
 
+    int im_width, im_height, n_channels;
+    unsigned char* im_data = stbi_load(texture->filename.c_str(), &im_width, &im_height, &n_channels, 0);
     if (!im_data) {
-        return NULL;
+        return false;
+    }
+    if (im_width != texture->im_width || im_height != texture->im_height || n_channels != texture->n_channels) {
+        stbi_image_free(im_data);
+        return false;
+    }
+
+    // Converted to the upload layout while writing to the pixel buffer
+    if (!is_cube || texture->atlas_layout) {
+        convertRegion(texture, im_data, 0, 0, im_width, im_height, texture->pbo_data);
+    } else {
+        // Faces one after the other
+        int face_size = texture->face_width * texture->face_height * texture->pixel_size;
+        for (int i = 0; i < 6; i++) {
+            int face_x = cube_face_offsets[i][0] * texture->face_width;
+            int face_y = cube_face_offsets[i][1] * texture->face_height;
+            convertRegion(texture, im_data, face_x, face_y, texture->face_width, texture->face_height, texture->pbo_data + i * face_size);
+        }
     }
-    updateColorFormat(texture);
 
-    return im_data;
+    stbi_image_free(im_data);
+    return true;
 }
 
-bool CubemapTexture::loadCube(Texture* texture) {
-    glGenTextures(1, &texture->id);
+bool CubemapTexture::decodeCompressed(Texture* texture, bool is_cube) {
+    KtxFile ktx;
+    if (!TextureCompressor::loadCached(texture->filename, is_cube, texture->is_normal_map, &ktx)) {
+        return false;
+    }
 
-    unsigned char** textures_faces = loadFaces(texture);
-    if (textures_faces) {
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id);
+    // Cache not matching the image header, rebuild it
+    if (ktx.getByteSize() != texture->pbo_size || ktx.width != texture->face_width || ktx.height != texture->face_height) {
+        if (!TextureCompressor::encode(texture->filename, is_cube, texture->is_normal_map, &ktx)) {
+            return false;
+        }
+        ktx.write(TextureCompressor::cachePath(texture->filename));
+    }
 
-        for (int i = 0; i < 6; i++) {
-            unsigned char* face_data = textures_faces[i];
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, texture->face_width, texture->face_height, 0, texture->color_format, GL_UNSIGNED_BYTE, face_data);
+    // Level by level, faces in order, the same order they are uploaded
+    unsigned char* dst = texture->pbo_data;
+    for (const vector<unsigned char>& image : ktx.images) {
+        memcpy(dst, image.data(), image.size());
+        dst += image.size();
+    }
+    return true;
+}
+
+bool CubemapTexture::updateTexture(Texture* texture) {
+    if (texture->state == TEXTURE_DECODING) {
+        if (texture->decoding.wait_for(chrono::seconds(0)) != future_status::ready) {
+            return false;
+        }
+        bool decoded = texture->decoding.get();
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture->pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        texture->pbo_data = NULL;
+
+        // Neither loading nor re-encoding the cache worked: storage and pixel buffer were sized
+        // for the compressed format, so they are rebuilt for the uncompressed path
+        if (!decoded && texture->compress) {
+            cerr << "Texture " << texture->id << " - Failed to compress, loading uncompressed: " << texture->filename << endl;
+            glDeleteBuffers(1, &texture->pbo);
+            glDeleteTextures(1, &texture->id);
+            startDecoding(texture, texture->target == GL_TEXTURE_CUBE_MAP, false);
+            return false;
+        }
+        if (!decoded) {
+            cerr << "Texture " << texture->id << " - Failed to load: " << texture->filename << endl;
+            glDeleteBuffers(1, &texture->pbo);
+            glDeleteTextures(1, &texture->id);
+            texture->id = 0;
+            texture->state = TEXTURE_FAILED;
+            return false;
         }
-        setTexParameters();
 
-        for (int i = 0; i < 6; i++) {
-            free(textures_faces[i]);
+        // Copies from the bound pixel buffer run asynchronously on the driver side
+        if (texture->compress) {
+            uploadCompressed(texture);
+        } else if (texture->target == GL_TEXTURE_2D) {
+            uploadFlat(texture);
+        } else {
+            uploadCube(texture);
         }
-        free(textures_faces);
-        return true;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-    } else {
-        return false;
+        texture->upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        texture->state = TEXTURE_UPLOADING;
+    }
+
+    if (texture->state == TEXTURE_UPLOADING) {
+        GLenum status = glClientWaitSync((GLsync)texture->upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return false;
+        }
+        glDeleteSync((GLsync)texture->upload_fence);
+        glDeleteBuffers(1, &texture->pbo);
+        texture->state = TEXTURE_READY;
+
+        auto load_ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - load_start).count() / 1000.0;
+        cout << "Texture " << texture->id << " - " << (texture->is_normal_map ? "Normal map" : "Diffuse") << (texture->target == GL_TEXTURE_2D ? " flat" : " cube")
+             << (texture->compress ? " (compressed)" : "") << " loaded in " << load_ms << " ms: " << texture->filename << endl;
     }
+
+    return texture->state == TEXTURE_READY;
 }
 
-unsigned char** CubemapTexture::loadFaces(Texture* texture) {
-    int im_width, im_height, n_channels;
-    unsigned char* im_data = stbi_load(texture->filename.c_str(), &im_width, &im_height, &n_channels, 0);
+void CubemapTexture::waitTexture(Texture* texture) {
+    // Twice when a compressed decode falls back to the uncompressed one
+    while (texture->state == TEXTURE_DECODING) {
+        texture->decoding.wait();
+        updateTexture(texture);
+    }
+    if (texture->state == TEXTURE_UPLOADING) {
+        glClientWaitSync((GLsync)texture->upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        while (!updateTexture(texture)) {
+        }
+    }
+}
 
-    if (!im_data) {
-        return NULL;
+void CubemapTexture::releaseTexture(Texture* texture) {
+    // Failed textures released their GL objects already
+    if (texture->state == TEXTURE_IDLE || texture->state == TEXTURE_FAILED) {
+        return;
     }
-    texture->n_channels = n_channels;
-    updateColorFormat(texture);
 
-    if (im_height % 3 != 0 || im_width % 4 != 0) {
-        cerr << "Texture file " << texture->filename << " size does not match with cubemap" << endl;
-        return NULL;
+    // The worker may still be writing to the mapped buffer
+    if (texture->state == TEXTURE_DECODING) {
+        texture->decoding.wait();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture->pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    if (texture->state == TEXTURE_UPLOADING) {
+        glDeleteSync((GLsync)texture->upload_fence);
+    }
+    if (texture->state != TEXTURE_READY) {
+        glDeleteBuffers(1, &texture->pbo);
     }
 
-    int face_height = im_height / 3;
-    int face_width = im_width / 4;
-    texture->face_height = face_height;
-    texture->face_width = face_width;
+    glDeleteTextures(1, &texture->id);
+    texture->state = TEXTURE_IDLE;
+}
 
-    unsigned char** faces_buffer = (unsigned char**)malloc(6 * sizeof(unsigned char*));
-    for (int i = 0; i < 6; i++) {
-        faces_buffer[i] = (unsigned char*)malloc(face_height * face_width * n_channels * sizeof(unsigned char));
+size_t CubemapTexture::getTextureByteSize(Texture* texture) {
+    if (texture->state == TEXTURE_IDLE || texture->state == TEXTURE_FAILED) {
+        return 0;
     }
 
-    // Right face
-    int face_y = face_height;
-    int face_x = 2 * face_width;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[RIGHT_FACE]);
+    int num_faces = texture->target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    if (texture->compress) {
+        return TextureCompressor::compressedSize(texture->face_width, texture->face_height, num_faces, texture->is_normal_map);
+    }
+
+    // Uploaded texel size (BGRA8, RG8 for normal maps), plus the generated mip chain
+    size_t size = 0;
+    for (int level = 0; level < TextureCompressor::numLevels(texture->face_width, texture->face_height); level++) {
+        size += (size_t)std::max(1, texture->face_width >> level) * std::max(1, texture->face_height >> level) * texture->pixel_size;
+    }
+    return size * num_faces;
+}
 
-    // Left face
-    face_y = face_height;
-    face_x = 0;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[LEFT_FACE]);
+void CubemapTexture::allocateStorage(Texture* texture) {
+    glBindTexture(texture->target, texture->id);
+    int num_faces = texture->target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
 
-    // Top face
-    face_y = 0;
-    face_x = face_width;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[TOP_FACE]);
+    if (texture->compress) {
+        int num_levels = TextureCompressor::numLevels(texture->face_width, texture->face_height);
+        unsigned int format = TextureCompressor::compressedFormat(texture->is_normal_map);
+
+        for (int level = 0; level < num_levels; level++) {
+            int level_width = std::max(1, texture->face_width >> level);
+            int level_height = std::max(1, texture->face_height >> level);
+            int image_size = TextureCompressor::compressedImageSize(level_width, level_height, texture->is_normal_map);
+
+            for (int face = 0; face < num_faces; face++) {
+                unsigned int face_target = num_faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+                glCompressedTexImage2D(face_target, level, format, level_width, level_height, 0, image_size, NULL);
+            }
+        }
+        glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+    } else {
+        for (int face = 0; face < num_faces; face++) {
+            unsigned int face_target = num_faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            glTexImage2D(face_target, 0, texture->internal_format, texture->face_width, texture->face_height, 0, texture->color_format, texture->color_type, NULL);
+        }
+    }
+    setTexParameters(texture->target);
+}
 
-    // Bottom face
-    face_y = 2 * face_height;
-    face_x = face_width;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[BOTTOM_FACE]);
+void CubemapTexture::uploadFlat(Texture* texture) {
+    glBindTexture(GL_TEXTURE_2D, texture->id);
 
-    // Front face
-    face_y = face_height;
-    face_x = face_width;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[FRONT_FACE]);
+    // A single image, projected on the cube faces by the flat shaders
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->face_width, texture->face_height, texture->color_format, texture->color_type, (void*)0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
 
-    // Back face
-    face_y = face_height;
-    face_x = 3 * face_width;
-    copyFaceToBuffer(im_data, im_width, face_height, face_width, n_channels, face_y, face_x, faces_buffer[BACK_FACE]);
+void CubemapTexture::uploadCube(Texture* texture) {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id);
 
-    stbi_image_free(im_data);
-    return faces_buffer;
+    // Rows of two channel images are not always 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (texture->atlas_layout) {
+        // Faces are read straight from the atlas
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, texture->im_width);
+        for (int i = 0; i < 6; i++) {
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, cube_face_offsets[i][0] * texture->face_width);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, cube_face_offsets[i][1] * texture->face_height);
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, texture->face_width, texture->face_height, texture->color_format, texture->color_type, (void*)0);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    } else {
+        // Faces were laid out one after the other by the worker
+        size_t face_size = texture->face_width * texture->face_height * texture->pixel_size;
+        for (int i = 0; i < 6; i++) {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, texture->face_width, texture->face_height, texture->color_format, texture->color_type, (void*)(i * face_size));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 }
 
-void CubemapTexture::copyFaceToBuffer(unsigned char* data, int im_w, int f_h, int f_w, int n_c, int f_y, int f_x, unsigned char* buf) {
-    int buff_i = 0;
-    for (int y = f_y; y < f_y + f_h; y++) {
-        int y_offset = y * im_w * n_c;
+void CubemapTexture::uploadCompressed(Texture* texture) {
+    glBindTexture(texture->target, texture->id);
+    int num_faces = texture->target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    int num_levels = TextureCompressor::numLevels(texture->face_width, texture->face_height);
+    unsigned int format = TextureCompressor::compressedFormat(texture->is_normal_map);
+
+    // Mip levels were filtered and compressed offline
+    size_t offset = 0;
+    for (int level = 0; level < num_levels; level++) {
+        int level_width = std::max(1, texture->face_width >> level);
+        int level_height = std::max(1, texture->face_height >> level);
+        int image_size = TextureCompressor::compressedImageSize(level_width, level_height, texture->is_normal_map);
+
+        for (int face = 0; face < num_faces; face++) {
+            unsigned int face_target = num_faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            glCompressedTexSubImage2D(face_target, level, 0, 0, level_width, level_height, format, image_size, (void*)offset);
+            offset += image_size;
+        }
+    }
+}
 
-        for (int x = f_x; x < f_x + f_w; x++) {
-            int x_offset = x * n_c;
+void CubemapTexture::convertRegion(Texture* texture, unsigned char* im_data, int x, int y, int width, int height, unsigned char* dst) {
+    int n_channels = texture->n_channels;
+    for (int row = 0; row < height; row++) {
+        unsigned char* src_row = im_data + ((size_t)(y + row) * texture->im_width + x) * n_channels;
+        unsigned char* dst_row = dst + (size_t)row * width * texture->pixel_size;
 
-            for (int c = 0; c < n_c; c++) {
-                buf[buff_i++] = data[y_offset + x_offset + c];
+        if (texture->is_normal_map) {
+            // The worker owns the decoded image, safe to normalize in place
+            PixelConverter::normalizeVectors(src_row, n_channels, width);
+            PixelConverter::extractRG(src_row, n_channels, dst_row, width);
+        } else {
+            PixelConverter::toBGRA(src_row, n_channels, dst_row, width);
+            if (DIFFUSE_SRGB_TO_LINEAR) {
+                PixelConverter::srgbToLinear(dst_row, 4, width);
             }
         }
     }
 }
 
-void CubemapTexture::setTexParameters() {
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+bool CubemapTexture::hasUnpackSubimage() {
+    // Desktop GL always has it, GLES 2 contexts reject the enum
+    static int supported = -1;
+    if (supported < 0) {
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        supported = glGetError() == GL_INVALID_ENUM ? 0 : 1;
+    }
+    return supported == 1;
+}
+
+void CubemapTexture::setTexParameters(unsigned int target) {
+    // Trilinear filtering over the generated mip chain
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+
+    if (GLEW_EXT_texture_filter_anisotropic) {
+        float max_anisotropy;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+        glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(max_anisotropy, MAX_ANISOTROPY));
+    }
 }
 
-void CubemapTexture::updateColorFormat(Texture* texture) {
-    switch (texture->n_channels) {
-        case 1:
-            texture->color_format = GL_RED;
-            break;
-        case 2:
-            texture->color_format = GL_RG;
-            break;
-        case 3:
-            texture->color_format = GL_RGB;
-            break;
-        case 4:
-            texture->color_format = GL_RGBA;
-            break;
+void CubemapTexture::updateUploadFormat(Texture* texture) {
+    if (texture->is_normal_map) {
+        // Only X and Y are stored, the shaders rebuild Z
+        texture->internal_format = GL_RG8;
+        texture->color_format = GL_RG;
+        texture->color_type = GL_UNSIGNED_BYTE;
+        texture->pixel_size = 2;
+        return;
     }
+
+    // BGRA with a packed type is the layout drivers copy without repacking
+    texture->internal_format = GL_RGBA8;
+    texture->color_format = GL_BGRA;
+    texture->color_type = GL_UNSIGNED_INT_8_8_8_8_REV;
+    texture->pixel_size = 4;
 }
@@ -0,0 +1,179 @@
+#include "KtxFile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// See: https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+const unsigned char ktx_identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+const unsigned int ktx_endianness = 0x04030201;
+
+// Larger than any GL texture, rejects corrupt sizes before allocating
+#define KTX_MAX_DIMENSION 65536
+
+struct KtxHeader {
+    unsigned char identifier[12];
+    unsigned int endianness;
+    unsigned int gl_type;
+    unsigned int gl_type_size;
+    unsigned int gl_format;
+    unsigned int gl_internal_format;
+    unsigned int gl_base_internal_format;
+    unsigned int pixel_width;
+    unsigned int pixel_height;
+    unsigned int pixel_depth;
+    unsigned int number_of_array_elements;
+    unsigned int number_of_faces;
+    unsigned int number_of_mipmap_levels;
+    unsigned int bytes_of_key_value_data;
+};
+
+KtxFile::KtxFile() {
+    internal_format = 0;
+    base_internal_format = 0;
+    width = 0;
+    height = 0;
+    num_faces = 0;
+    num_levels = 0;
+}
+
+bool KtxFile::read(const string filename) {
+    ifstream file(filename.c_str(), ios::binary | ios::ate);
+    if (!file.good()) {
+        return false;
+    }
+    size_t file_size = (size_t)file.tellg();
+    file.seekg(0);
+
+    KtxHeader header;
+    file.read((char*)&header, sizeof(KtxHeader));
+    if (!file || memcmp(header.identifier, ktx_identifier, sizeof(ktx_identifier)) != 0 || header.endianness != ktx_endianness) {
+        return false;
+    }
+
+    // Only compressed, non-array textures are written by this viewer
+    if (header.gl_type != 0 || header.pixel_depth != 0 || header.number_of_array_elements != 0) {
+        return false;
+    }
+
+    // Truncated or corrupt caches are rejected here, before anything is allocated
+    if (header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_width > KTX_MAX_DIMENSION || header.pixel_height > KTX_MAX_DIMENSION) {
+        return false;
+    }
+    unsigned int max_levels = 1;
+    while ((std::max(header.pixel_width, header.pixel_height) >> max_levels) > 0) {
+        max_levels++;
+    }
+    if ((header.number_of_faces != 1 && header.number_of_faces != 6) || header.number_of_mipmap_levels > max_levels) {
+        return false;
+    }
+    if (header.bytes_of_key_value_data > file_size - sizeof(KtxHeader)) {
+        return false;
+    }
+
+    internal_format = header.gl_internal_format;
+    base_internal_format = header.gl_base_internal_format;
+    width = header.pixel_width;
+    height = header.pixel_height;
+    num_faces = header.number_of_faces;
+    num_levels = header.number_of_mipmap_levels > 0 ? header.number_of_mipmap_levels : 1;
+
+    // Each pair: byte size, key and value separated by a NUL, padded to 4 bytes
+    key_values.clear();
+    vector<char> key_value_data(header.bytes_of_key_value_data);
+    file.read(key_value_data.data(), key_value_data.size());
+    for (size_t offset = 0; offset + 4 <= key_value_data.size();) {
+        unsigned int size;
+        memcpy(&size, &key_value_data[offset], sizeof(unsigned int));
+        offset += 4;
+        if (size > key_value_data.size() - offset) {
+            return false;
+        }
+        string pair(&key_value_data[offset], size);
+        size_t separator = pair.find('\0');
+        if (separator != string::npos) {
+            string value = pair.substr(separator + 1);
+            key_values[pair.substr(0, separator)] = value.c_str();
+        }
+        offset += size + (4 - size % 4) % 4;
+    }
+
+    images.assign(num_levels * num_faces, vector<unsigned char>());
+    for (int level = 0; level < num_levels; level++) {
+        unsigned int image_size;
+        file.read((char*)&image_size, sizeof(unsigned int));
+        if (!file || (size_t)image_size * num_faces > file_size - (size_t)file.tellg()) {
+            return false;
+        }
+
+        for (int face = 0; face < num_faces; face++) {
+            vector<unsigned char>& image = images[level * num_faces + face];
+            image.resize(image_size);
+            file.read((char*)image.data(), image_size);
+            file.seekg((4 - image_size % 4) % 4, ios::cur);   // Cube padding
+        }
+    }
+
+    return (bool)file;
+}
+
+bool KtxFile::write(const string filename) const {
+    ofstream file(filename.c_str(), ios::binary);
+    if (!file.good()) {
+        return false;
+    }
+
+    KtxHeader header;
+    memcpy(header.identifier, ktx_identifier, sizeof(ktx_identifier));
+    header.endianness = ktx_endianness;
+    header.gl_type = 0;
+    header.gl_type_size = 1;
+    header.gl_format = 0;
+    header.gl_internal_format = internal_format;
+    header.gl_base_internal_format = base_internal_format;
+    header.pixel_width = width;
+    header.pixel_height = height;
+    header.pixel_depth = 0;
+    header.number_of_array_elements = 0;
+    header.number_of_faces = num_faces;
+    header.number_of_mipmap_levels = num_levels;
+    const char padding[4] = { 0, 0, 0, 0 };
+    string key_value_data;
+    for (const pair<const string, string>& key_value : key_values) {
+        unsigned int size = (unsigned int)(key_value.first.size() + key_value.second.size() + 2);
+        key_value_data.append((const char*)&size, sizeof(unsigned int));
+        key_value_data.append(key_value.first).append(1, '\0');
+        key_value_data.append(key_value.second).append(1, '\0');
+        key_value_data.append(padding, (4 - size % 4) % 4);
+    }
+
+    header.bytes_of_key_value_data = (unsigned int)key_value_data.size();
+    file.write((const char*)&header, sizeof(KtxHeader));
+    file.write(key_value_data.data(), key_value_data.size());
+
+    for (int level = 0; level < num_levels; level++) {
+        unsigned int image_size = getImage(level, 0).size();
+        file.write((const char*)&image_size, sizeof(unsigned int));
+
+        for (int face = 0; face < num_faces; face++) {
+            const vector<unsigned char>& image = getImage(level, face);
+            file.write((const char*)image.data(), image.size());
+            file.write(padding, (4 - image.size() % 4) % 4);
+        }
+    }
+
+    return (bool)file;
+}
+
+const vector<unsigned char>& KtxFile::getImage(int level, int face) const {
+    return images[level * num_faces + face];
+}
+
+size_t KtxFile::getByteSize() const {
+    size_t size = 0;
+    for (const vector<unsigned char>& image : images) {
+        size += image.size();
+    }
+    return size;
+}
@@ -6,9 +6,16 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <thread>
 #include <vector>
 
+#include "SoftwareRenderer.hpp"
+
 using namespace std;
 using namespace glm;
 
@@ -29,11 +36,6 @@ using namespace glm;
 #define FACES_MODE 0
 #define WIREFRAME_MODE 1
 
-// Color modes
-#define LIGHTNING_MODE 0
-#define TEXTURE_MODE 1
-#define TEXTURE_NORMAL_MODE 2
-
 // Axis directions
 const vec3 axis_x_dir = { 1.0f, 0.0f, 0.0f };
 const vec3 axis_y_dir = { 0.0f, 1.0f, 0.0f };
@@ -54,6 +56,10 @@ void specialKeys(int key, int x, int y) {
     MeshViewer::instance()->_specialKeys(key, x, y);
 }
 
+void mouse(int button, int state, int x, int y) {
+    MeshViewer::instance()->_mouse(button, state, x, y);
+}
+
 void idle() { MeshViewer::instance()->_idle(); }
 
 /** MeshViewer members */
@@ -69,13 +75,28 @@ MeshViewer* MeshViewer::instance() {
 void MeshViewer::init(int argc, char** argv) {
     // Check .obj file argument
     if (argc < 4) {
-        cerr << "Usage: ./mesh2 object.obj texture.ext normal_map.ext2" << endl;
+        cerr << "Usage: ./mesh2 object.obj texture.ext normal_map.ext2 [texture_budget_mb]" << endl;
+        cerr << "       ./mesh2 object.obj texture.ext normal_map.ext2 --software output.ppm|png [color_mode 1-3] [frames]" << endl;
         exit(-1);
     }
     string mesh_filename = argv[1];
     string texture_filename = argv[2];
     string normal_map_filename = argv[3];
 
+    // CPU render to an image, no window
+    if (argc > 5 && string(argv[4]) == "--software") {
+        initAttributes();
+        if (argc > 6) {
+            color_mode = std::min(std::max(atoi(argv[6]) - 1, (int)LIGHTNING_MODE), (int)TEXTURE_NORMAL_MODE);
+        }
+        renderSoftware(mesh_filename, texture_filename, normal_map_filename, argv[5], argc > 7 ? std::max(1, atoi(argv[7])) : 1);
+        return;
+    }
+
+    if (argc > 4) {
+        texture_manager.setBudget((size_t)atoi(argv[4]) * 1024 * 1024);
+    }
+
     // Init MeshViewer attributes
     initAttributes();
 
@@ -96,11 +117,15 @@ void MeshViewer::init(int argc, char** argv) {
     glutDisplayFunc(display);
     glutKeyboardFunc(keyboard);
     glutSpecialFunc(specialKeys);
+    glutMouseFunc(mouse);
     glutIdleFunc(idle);
 
     // Enable depth test
     glEnable(GL_DEPTH_TEST);
 
+    // Filter across cube face edges on the smaller mip levels
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
     glutMainLoop();
 }
 
@@ -118,12 +143,18 @@ void MeshViewer::initAttributes() {
     transform_mode = TRANSLATION_MODE;
     polygon_mode = FACES_MODE;
     color_mode = LIGHTNING_MODE;
+    occlusion_culling = true;
 
     /** Shaders */
     shaders.push_back(new Shader("./shaders/light_vtx.glsl", "./shaders/light_frag.glsl"));
     shaders.push_back(new Shader("./shaders/text_vtx.glsl", "./shaders/text_frag.glsl"));
     shaders.push_back(new Shader("./shaders/normal_vtx.glsl", "./shaders/normal_frag.glsl"));
 
+    // Flat textures are a single 2D image projected on the cube faces
+    flat_shaders.push_back(shaders[LIGHTNING_MODE]);
+    flat_shaders.push_back(new Shader("./shaders/text_vtx.glsl", "./shaders/text_flat_frag.glsl"));
+    flat_shaders.push_back(new Shader("./shaders/normal_vtx.glsl", "./shaders/normal_flat_frag.glsl"));
+
     /** Camera */
     camera_position = vec3{ 0.0f, 0.0f, 0.0f };
     camera_target = vec3{ 0.0f, 0.0f, 0.0f };
@@ -147,8 +178,24 @@ void MeshViewer::initAttributes() {
 }
 
 void MeshViewer::loadResources(string mesh_file, string texture_file, string normal_map_file) {
+    int start_time = glutGet(GLUT_ELAPSED_TIME);
+
+    // Start decoding texture images on worker threads, overlapped with mesh parsing
+    texture = texture_manager.get(texture_file, normal_map_file);
+    if (texture == NULL) {
+        exit(-1);
+    }
+    findMaterialSets(texture_file, normal_map_file);
+    previous_material_index = material_index;
+
     // Load mesh
     scene_mesh.load(mesh_file);
+    scene_mesh.buildBVH(&bvh, std::max(1u, thread::hardware_concurrency()));
+
+    // The mesh under a root, more models can be placed as siblings or children
+    scene_graph.clear();
+    unsigned int root = scene_graph.addNode(NO_PARENT, mat4{ 1.0f });
+    mesh_node = scene_graph.addNode(root, scene_mesh.getTransformation(), &scene_mesh);
 
     fitViewProjection();
 
@@ -156,12 +203,63 @@ void MeshViewer::loadResources(string mesh_file, string texture_file, string nor
     for (Shader* s : shaders) {
         s->load();
     }
+    for (unsigned int i = TEXTURE_MODE; i < flat_shaders.size(); i++) {
+        flat_shaders[i]->load();
+    }
     changeColorMode(color_mode);
 
-    bool is_flat = texture_file.find("flat") != string::npos;
-    texture = new CubemapTexture(texture_file, normal_map_file, is_flat);
-    texture->load();
-    texture->use();
+    // Textures keep streaming in from the idle callback
+    texture_manager.update();
+
+    cout << "Resources loaded in " << glutGet(GLUT_ELAPSED_TIME) - start_time << " ms" << endl;
+}
+
+void MeshViewer::findMaterialSets(string texture_file, string normal_map_file) {
+    namespace fs = std::filesystem;
+
+    // Every texture in the sibling directories of the given one (e.g. resources/text_*)
+    fs::path resources_dir = fs::path(texture_file).parent_path().parent_path();
+    if (resources_dir.empty()) {
+        resources_dir = ".";
+    }
+
+    error_code error;
+    for (const fs::directory_entry& dir : fs::directory_iterator(resources_dir, error)) {
+        if (!dir.is_directory()) {
+            continue;
+        }
+        for (const fs::directory_entry& file : fs::directory_iterator(dir.path(), error)) {
+            fs::path path = file.path();
+            string ext = path.extension().string();
+            string stem = path.stem().string();
+            if ((ext != ".jpg" && ext != ".png") || stem.find("_normal") != string::npos) {
+                continue;
+            }
+
+            string normal_map;
+            for (string normal_ext : { ".jpg", ".png" }) {
+                fs::path normal_path = path.parent_path() / (stem + "_normal" + normal_ext);
+                if (fs::exists(normal_path)) {
+                    normal_map = normal_path.string();
+                }
+            }
+            material_sets.push_back({ path.string(), normal_map });
+        }
+    }
+    sort(material_sets.begin(), material_sets.end());
+
+    // Keep the file names given on the command line, they are the texture manager keys
+    material_index = material_sets.size();
+    for (unsigned int i = 0; i < material_sets.size(); i++) {
+        if (fs::equivalent(material_sets[i].first, texture_file, error)) {
+            material_sets[i] = { texture_file, normal_map_file };
+            material_index = i;
+        }
+    }
+    if (material_index == material_sets.size()) {
+        material_sets.push_back({ texture_file, normal_map_file });
+    }
+    cout << "Found " << material_sets.size() << " material sets" << endl;
 }
 
 void MeshViewer::fitViewProjection() {
@@ -189,23 +287,89 @@ void MeshViewer::fitViewProjection() {
     translation_proportion = 0.05 * std::max(std::max(scene_box_size.x, scene_box_size.y), scene_box_size.z);
 }
 
+void MeshViewer::renderSoftware(string mesh_file, string texture_file, string normal_map_file, string output_file, int num_frames) {
+    // Mesh data is not uploaded, there is no GL context
+    scene_mesh.load(mesh_file, false);
+    fitViewProjection();
+    model = scene_mesh.getTransformation();
+
+    int num_threads = std::max(1u, thread::hardware_concurrency());
+    SoftwareRenderer renderer(win_width, win_height, num_threads);
+
+    // Same rule as the texture manager
+    bool is_flat = texture_file.find("flat") != string::npos;
+    renderer.loadMaterial(texture_file, normal_map_file, is_flat);
+    if (color_mode == TEXTURE_NORMAL_MODE && !renderer.hasNormalMap()) {
+        cerr << "Texture does not have normal map!" << endl;
+        color_mode = TEXTURE_MODE;
+    }
+
+    ShadingParams params;
+    params.color_mode = color_mode;
+    params.model = model;
+    params.view = view;
+    params.projection = projection;
+    params.light_color = light_color;
+    params.light_position = light_position;
+    params.camera_position = camera_position;
+    params.object_color = default_object_color;
+    params.object_center = scene_mesh.getCenter();
+    params.background_color = background_color;
+
+    vector<Mesh> meshes = scene_mesh.getMeshList();
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < num_frames; i++) {
+        renderer.render(meshes, params);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Software renderer (" << num_threads << " threads, color mode " << color_mode << "): " << num_frames << " frames in " << seconds * 1000.0 << " ms" << endl;
+    cout << "  " << num_frames / seconds << " fps, " << renderer.getNumTriangles() * num_frames / seconds / 1e6 << " M triangles/s (" << renderer.getNumTriangles() << " submitted, "
+         << renderer.getNumRasterized() << " rasterized per frame)" << endl;
+
+    if (!renderer.writeImage(output_file)) {
+        cerr << "Failed to write image: " << output_file << endl;
+        exit(-1);
+    }
+    cout << "Frame written to " << output_file << endl;
+}
+
+Shader* MeshViewer::getShader(unsigned short mode) {
+    if (mode != LIGHTNING_MODE && texture->isFlat()) {
+        return flat_shaders[mode];
+    }
+    return shaders[mode];
+}
+
 void MeshViewer::_display() {
     glClearColor(background_color.r, background_color.g, background_color.b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    model = scene_mesh.getTransformation();
+    // World matrices of the nodes transformed since the last frame
+    scene_graph.update();
+    model = scene_graph.getWorldTransform(mesh_node);
 
-    Shader* shader = shaders[color_mode];
+    // Light only until the textures finished streaming in
+    short mode = texture->isReady() ? color_mode : LIGHTNING_MODE;
+    if (mode == TEXTURE_NORMAL_MODE && !texture->hasNormalMap()) {
+        mode = TEXTURE_MODE;
+    }
+    Shader* shader = getShader(mode);
+    shader->use();
 
     shader->setVec3("light_color", light_color);
     shader->setVec3("light_position", light_position);
     shader->setVec3("camera_position", camera_position);
 
-    shader->setMat4("model", model);
     shader->setMat4("view", view);
     shader->setMat4("projection", projection);
 
-    switch (color_mode) {
+    // Other textures streaming in the background may have changed the bindings
+    if (mode != LIGHTNING_MODE) {
+        texture->use();
+    }
+
+    switch (mode) {
         case LIGHTNING_MODE:
             bindLightMode(shader);
             break;
@@ -217,11 +381,54 @@ void MeshViewer::_display() {
             break;
     }
 
-    for (Mesh mesh : scene_mesh.getMeshList()) {
-        glBindVertexArray(mesh.VAO);
-        // glDrawElements(GL_TRIANGLES, (GLsizei)mesh.vert_normals.size(), GL_UNSIGNED_INT, 0);
-        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mesh.vert_positions.size());
-        glBindVertexArray(0);
+    // Hidden meshes are skipped before any GL call, wireframes do not occlude. Meshes of every node
+    // are culled together, so one model can hide another
+    bool culling = occlusion_culling && polygon_mode == FACES_MODE;
+    cull_meshes.clear();
+    cull_matrices.clear();
+    for (unsigned int node = 0; node < scene_graph.getNumNodes(); node++) {
+        const SceneMesh* node_mesh = scene_graph.getMesh(node);
+        if (node_mesh == nullptr) {
+            continue;
+        }
+        mat4 model_view_projection = projection * view * scene_graph.getWorldTransform(node);
+        for (const Mesh& mesh : node_mesh->getMeshList()) {
+            cull_meshes.push_back(&mesh);
+            cull_matrices.push_back(model_view_projection);
+        }
+    }
+    mesh_visible.assign(cull_meshes.size(), true);
+    if (culling) {
+        occlusion_culler.cull(cull_meshes, cull_matrices, &mesh_visible);
+    }
+
+    // Same node and mesh order as the gathering above
+    size_t index = 0;
+    for (unsigned int node = 0; node < scene_graph.getNumNodes(); node++) {
+        const SceneMesh* node_mesh = scene_graph.getMesh(node);
+        if (node_mesh == nullptr) {
+            continue;
+        }
+        shader->setMat4("model", scene_graph.getWorldTransform(node));
+        if (mode != LIGHTNING_MODE) {
+            shader->setVec3("object_center", node_mesh->getCenter());
+        }
+
+        for (const Mesh& mesh : node_mesh->getMeshList()) {
+            if (!mesh_visible[index++]) {
+                continue;
+            }
+            glBindVertexArray(mesh.VAO);
+            glDrawElements(GL_TRIANGLES, (GLsizei)mesh.vert_indices.size(), GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+        }
+    }
+
+    if (culling) {
+        char title[128];
+        snprintf(title, sizeof(title), "Mesh viewer - %u/%zu meshes culled, %u occluders, %.2f ms", occlusion_culler.getNumCulled(), cull_meshes.size(),
+                 occlusion_culler.getNumOccluders(), occlusion_culler.getCostMs());
+        glutSetWindowTitle(title);
     }
 
     glutSwapBuffers();
@@ -236,7 +443,6 @@ void MeshViewer::bindLightMode(Shader* shader) {
 }
 
 void MeshViewer::bindTextMode(Shader* shader) {
-    shader->setVec3("object_center", scene_mesh.getCenter());
     shader->setInt("diffuse_map", 0);
 }
 
@@ -279,6 +485,15 @@ void MeshViewer::_keyboard(unsigned char key, int x, int y) {
         case 'v':
             switchPolygonMode();
             break;
+        case 'o':
+            switchOcclusionCulling();
+            break;
+        case 'n':
+            changeMaterial(1);
+            break;
+        case 'b':
+            changeMaterial(-1);
+            break;
         case 'a':
             transformMesh(KEY_A);
             break;
@@ -307,7 +522,36 @@ void MeshViewer::_specialKeys(int key, int x, int y) {
     }
 }
 
+void MeshViewer::_mouse(int button, int state, int x, int y) {
+    if (state != GLUT_DOWN) {
+        return;
+    }
+
+    switch (button) {
+        case GLUT_LEFT_BUTTON:
+            pick(x, y);
+            break;
+        case GLUT_RIGHT_BUTTON:
+            scene_mesh.setPivot(scene_mesh.getCenter());
+            cout << "Rotation pivot reset to the center" << endl;
+            break;
+    }
+}
+
 void MeshViewer::_idle() {
+    texture_manager.update();
+
+    // A material that failed to decode is dropped, going back to the one shown before it
+    if (texture->hasFailed() && previous_material_index != material_index) {
+        CubemapTexture* previous = texture_manager.get(material_sets[previous_material_index].first, material_sets[previous_material_index].second);
+        if (previous != NULL) {
+            unsigned int failed = material_index;
+            material_index = previous_material_index;
+            texture = previous;
+            removeMaterial(failed);
+            cout << "Material set to " << material_sets[material_index].first << endl;
+        }
+    }
     glutPostRedisplay();
 }
 
@@ -316,8 +560,44 @@ void MeshViewer::changeColorMode(unsigned short mode) {
         cerr << "Texture does not have normal map!" << endl;
     } else {
         color_mode = mode;
-        shaders[color_mode]->use();
-        cout << "Color mode set to " << color_mode << ", shader " << shaders[color_mode]->getId() << endl;
+        getShader(color_mode)->use();
+        cout << "Color mode set to " << color_mode << ", shader " << getShader(color_mode)->getId() << endl;
+    }
+}
+
+void MeshViewer::changeMaterial(int step) {
+    int num_sets = material_sets.size();
+    unsigned int index = (material_index + num_sets + step) % num_sets;
+    if (index == material_index) {
+        return;
+    }
+
+    // Unreadable materials are skipped, the current one stays on screen
+    CubemapTexture* next_texture = texture_manager.get(material_sets[index].first, material_sets[index].second);
+    if (next_texture == NULL) {
+        removeMaterial(index);
+        return;
+    }
+
+    previous_material_index = material_index;
+    material_index = index;
+    texture = next_texture;
+    cout << "Material set to " << material_sets[material_index].first << endl;
+    texture_manager.printStats();
+}
+
+void MeshViewer::removeMaterial(unsigned int index) {
+    cerr << "Skipping material " << material_sets[index].first << endl;
+    material_sets.erase(material_sets.begin() + index);
+
+    if (previous_material_index == index) {
+        previous_material_index = material_index;
+    }
+    if (previous_material_index > index) {
+        previous_material_index--;
+    }
+    if (material_index > index) {
+        material_index--;
     }
 }
 
@@ -333,6 +613,44 @@ void MeshViewer::switchPolygonMode() {
     }
 }
 
+void MeshViewer::switchOcclusionCulling() {
+    occlusion_culling = !occlusion_culling;
+    if (!occlusion_culling) {
+        glutSetWindowTitle("Mesh viewer");
+    }
+    cout << "Occlusion culling " << (occlusion_culling ? "enabled" : "disabled") << endl;
+}
+
+void MeshViewer::pick(int x, int y) {
+    auto start = chrono::steady_clock::now();
+
+    // Cursor on the near and far planes, back to world then model space
+    float ndc_x = 2.0f * (x + 0.5f) / win_width - 1.0f;
+    float ndc_y = 1.0f - 2.0f * (y + 0.5f) / win_height;
+    mat4 inv_model_view_projection = inverse(projection * view * model);
+    vec4 near_point = inv_model_view_projection * vec4{ ndc_x, ndc_y, -1.0f, 1.0f };
+    vec4 far_point = inv_model_view_projection * vec4{ ndc_x, ndc_y, 1.0f, 1.0f };
+
+    Ray ray;
+    ray.origin = vec3(near_point) / near_point.w;
+    ray.direction = vec3(far_point) / far_point.w - ray.origin;
+    ray.t_min = 0.0f;
+    ray.t_max = 1.0f;
+
+    RayHit hit;
+    bool found = bvh.intersect(ray, &hit);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (!found) {
+        cout << "Nothing picked (" << ms << " ms)" << endl;
+        return;
+    }
+
+    // Picked point becomes the rotation pivot
+    vec3 position = ray.origin + ray.direction * hit.t;
+    scene_mesh.setPivot(position);
+    cout << "Picked mesh " << hit.mesh << ", triangle " << hit.triangle << " at " << to_string(vec3(model * vec4(position, 1.0f))) << " (" << ms << " ms)" << endl;
+}
+
 void MeshViewer::transformMesh(unsigned short key) {
     switch (transform_mode) {
         case TRANSLATION_MODE:
@@ -345,6 +663,8 @@ void MeshViewer::transformMesh(unsigned short key) {
             scaleMesh(key);
             break;
     }
+
+    scene_graph.setLocalTransform(mesh_node, scene_mesh.getTransformation());
 }
 
 void MeshViewer::translateMesh(unsigned short key) {
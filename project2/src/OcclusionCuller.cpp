@@ -0,0 +1,218 @@
+#include "OcclusionCuller.hpp"
+#include <algorithm>
+#include <chrono>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// Meshes covering at least this fraction of the screen are occluders
+#define OCCLUDER_MIN_AREA 0.05f
+
+// Occluder triangles rasterized per frame, the largest occluders first
+#define MAX_OCCLUDER_TRIANGLES 65536
+
+OcclusionCuller::OcclusionCuller() {
+    depth.resize(OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+    dilated.resize(OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+    for (int w = OCCLUSION_WIDTH, h = OCCLUSION_HEIGHT; w >= 1 && h >= 1; w /= 2, h /= 2) {
+        levels.push_back(vector<float>((size_t)w * h));
+    }
+
+    num_occluders = 0;
+    num_culled = 0;
+    cost_ms = 0.0;
+}
+
+void OcclusionCuller::cull(const vector<const Mesh*>& meshes, const vector<mat4>& model_view_projections, vector<bool>* visible) {
+    auto start = chrono::steady_clock::now();
+
+    // (1) Screen rectangles, meshes crossing the near plane are always visible
+    vector<ivec4> rects(meshes.size());
+    vector<float> min_depths(meshes.size());
+    vector<bool> projected(meshes.size());
+    vector<pair<int, unsigned int>> occluders;
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        projected[i] = projectBox(meshes[i]->bound_box_min, meshes[i]->bound_box_max, model_view_projections[i], &rects[i], &min_depths[i]);
+        if (!projected[i]) {
+            continue;
+        }
+        ivec4 r = rects[i];
+        int area = (std::min(r.z, OCCLUSION_WIDTH - 1) - std::max(r.x, 0) + 1) * (std::min(r.w, OCCLUSION_HEIGHT - 1) - std::max(r.y, 0) + 1);
+        if (r.x <= r.z && r.y <= r.w && area >= OCCLUDER_MIN_AREA * OCCLUSION_WIDTH * OCCLUSION_HEIGHT) {
+            occluders.push_back({ -area, i });
+        }
+    }
+    sort(occluders.begin(), occluders.end());
+
+    // (2) Occluders into the depth buffer
+    fill(depth.begin(), depth.end(), 1.0f);
+    num_occluders = 0;
+    size_t num_triangles = 0;
+    for (const pair<int, unsigned int>& occluder : occluders) {
+        const Mesh& mesh = *meshes[occluder.second];
+        if (num_triangles + mesh.vert_indices.size() / 3 > MAX_OCCLUDER_TRIANGLES) {
+            continue;
+        }
+        rasterizeOccluder(mesh, model_view_projections[occluder.second]);
+        num_triangles += mesh.vert_indices.size() / 3;
+        num_occluders++;
+    }
+    buildLevels();
+
+    // (3) Boxes against the max depth mips
+    visible->assign(meshes.size(), true);
+    num_culled = 0;
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        if (!projected[i]) {
+            continue;
+        }
+        ivec4 r = rects[i];
+        bool off_screen = r.z < 0 || r.w < 0 || r.x >= OCCLUSION_WIDTH || r.y >= OCCLUSION_HEIGHT || r.x > r.z || r.y > r.w;
+        if (off_screen || isOccluded(r, min_depths[i])) {
+            (*visible)[i] = false;
+            num_culled++;
+        }
+    }
+
+    cost_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionCuller::projectBox(vec3 box_min, vec3 box_max, const mat4& model_view_projection, ivec4* rect, float* min_depth) const {
+    vec2 screen_min(1e30f), screen_max(-1e30f);
+    *min_depth = 1.0f;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner((i & 1) ? box_max.x : box_min.x, (i & 2) ? box_max.y : box_min.y, (i & 4) ? box_max.z : box_min.z);
+        vec4 clip = model_view_projection * vec4(corner, 1.0f);
+        if (clip.z < -clip.w) {
+            return false;
+        }
+
+        // Same viewport transform as the software renderer, nearest corner depth
+        vec3 ndc = vec3(clip) / clip.w;
+        vec2 screen((ndc.x * 0.5f + 0.5f) * OCCLUSION_WIDTH, (0.5f - ndc.y * 0.5f) * OCCLUSION_HEIGHT);
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+        *min_depth = std::min(*min_depth, ndc.z * 0.5f + 0.5f);
+    }
+
+    // Clamped before the conversion, boxes may project far outside
+    vec2 lo = glm::clamp(screen_min, -1.0f, (float)OCCLUSION_WIDTH + 1.0f);
+    vec2 hi = glm::clamp(screen_max, -1.0f, (float)OCCLUSION_WIDTH + 1.0f);
+    *rect = ivec4((int)floor(lo.x), (int)floor(lo.y), (int)floor(hi.x), (int)floor(hi.y));
+    return true;
+}
+
+void OcclusionCuller::rasterizeOccluder(const Mesh& mesh, const mat4& model_view_projection) {
+    vertices.resize(mesh.vert_positions.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertices[i].position = model_view_projection * vec4(mesh.vert_positions[i], 1.0f);
+    }
+
+    ClipPolygon polygon;
+    for (size_t t = 0; t + 2 < mesh.vert_indices.size(); t += 3) {
+        // Only the position is needed, no attributes
+        if (clipper.clip(vertices[mesh.vert_indices[t]], vertices[mesh.vert_indices[t + 1]], vertices[mesh.vert_indices[t + 2]], 0, &polygon) == CLIP_REJECTED) {
+            continue;
+        }
+
+        vec2 screen[CLIP_MAX_VERTICES];
+        float z[CLIP_MAX_VERTICES];
+        for (int k = 0; k < polygon.size; k++) {
+            vec4 p = polygon.vertices[k].position;
+            screen[k] = vec2((p.x / p.w * 0.5f + 0.5f) * OCCLUSION_WIDTH, (0.5f - p.y / p.w * 0.5f) * OCCLUSION_HEIGHT);
+            z[k] = p.z / p.w * 0.5f + 0.5f;
+        }
+
+        for (int k = 1; k + 1 < polygon.size; k++) {
+            vec2 fan_screen[3] = { screen[0], screen[k], screen[k + 1] };
+            float fan_z[3] = { z[0], z[k], z[k + 1] };
+            HalfSpaceTriangle triangle;
+            if (!setupHalfSpace(fan_screen, fan_z, &triangle)) {
+                continue;
+            }
+
+            blocks.clear();
+            rasterizeBlocks(triangle, BLOCK_8X1, 0, 0, OCCLUSION_WIDTH - 1, OCCLUSION_HEIGHT - 1, &blocks);
+            for (const RasterBlock& block : blocks) {
+                // Blocks are 8 aligned, never crossing a row
+                float* dst = &depth[(size_t)block.y * OCCLUSION_WIDTH + block.x];
+#ifdef __AVX2__
+                __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+                __m256i covered = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(block.mask), lanes), lanes);
+                __m256 nearest = _mm256_min_ps(_mm256_loadu_ps(dst), _mm256_load_ps(block.z));
+                _mm256_storeu_ps(dst, _mm256_blendv_ps(_mm256_loadu_ps(dst), nearest, _mm256_castsi256_ps(covered)));
+#else
+                for (int i = 0; i < 8; i++) {
+                    if (block.mask & (1u << i)) {
+                        dst[i] = std::min(dst[i], block.z[i]);
+                    }
+                }
+#endif
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildLevels() {
+    // 3x3 max (rows, then columns): pixels next to uncovered ones (partially covered at this resolution) do not occlude
+    for (int y = 0; y < OCCLUSION_HEIGHT; y++) {
+        const float* src = &depth[(size_t)y * OCCLUSION_WIDTH];
+        float* dst = &dilated[(size_t)y * OCCLUSION_WIDTH];
+        for (int x = 0; x < OCCLUSION_WIDTH; x++) {
+            dst[x] = std::max(std::max(src[std::max(x - 1, 0)], src[x]), src[std::min(x + 1, OCCLUSION_WIDTH - 1)]);
+        }
+    }
+    for (int y = 0; y < OCCLUSION_HEIGHT; y++) {
+        const float* above = &dilated[(size_t)std::max(y - 1, 0) * OCCLUSION_WIDTH];
+        const float* row = &dilated[(size_t)y * OCCLUSION_WIDTH];
+        const float* below = &dilated[(size_t)std::min(y + 1, OCCLUSION_HEIGHT - 1) * OCCLUSION_WIDTH];
+        float* dst = &levels[0][(size_t)y * OCCLUSION_WIDTH];
+        for (int x = 0; x < OCCLUSION_WIDTH; x++) {
+            dst[x] = std::max(std::max(above[x], row[x]), below[x]);
+        }
+    }
+
+    int width = OCCLUSION_WIDTH;
+    for (size_t l = 1; l < levels.size(); l++) {
+        const vector<float>& src = levels[l - 1];
+        int half_width = width / 2;
+        int half_height = (int)(levels[l].size() / half_width);
+        for (int y = 0; y < half_height; y++) {
+            for (int x = 0; x < half_width; x++) {
+                const float* row0 = &src[(size_t)(y * 2) * width + x * 2];
+                const float* row1 = row0 + width;
+                levels[l][(size_t)y * half_width + x] = std::max(std::max(row0[0], row0[1]), std::max(row1[0], row1[1]));
+            }
+        }
+        width = half_width;
+    }
+}
+
+bool OcclusionCuller::isOccluded(ivec4 rect, float min_depth) const {
+    int x0 = std::max(rect.x, 0), y0 = std::max(rect.y, 0);
+    int x1 = std::min(rect.z, OCCLUSION_WIDTH - 1), y1 = std::min(rect.w, OCCLUSION_HEIGHT - 1);
+
+    // Coarsest level where the rectangle spans at most 2x2 texels
+    int level = 0;
+    while (level + 1 < (int)levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        level++;
+    }
+
+    int level_width = OCCLUSION_WIDTH >> level;
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            if (min_depth <= levels[level][(size_t)y * level_width + x]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+unsigned int OcclusionCuller::getNumOccluders() const { return num_occluders; }
+unsigned int OcclusionCuller::getNumCulled() const { return num_culled; }
+double OcclusionCuller::getCostMs() const { return cost_ms; }
@@ -0,0 +1,142 @@
+#include "PixelConverter.hpp"
+#include <array>
+#include <cmath>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+void PixelConverter::toBGRA(const unsigned char* src, int n_channels, unsigned char* dst, size_t num_pixels) {
+    switch (n_channels) {
+        case 3:
+            expandRGBToBGRA(src, dst, num_pixels);
+            break;
+        case 4:
+            swizzleRGBAToBGRA(src, dst, num_pixels);
+            break;
+        default:
+            // Gray and gray-alpha images replicate the first channel, gray-alpha keeps its alpha
+            for (size_t i = 0; i < num_pixels; i++) {
+                unsigned char v = src[i * n_channels];
+                dst[i * 4] = v;
+                dst[i * 4 + 1] = v;
+                dst[i * 4 + 2] = v;
+                dst[i * 4 + 3] = n_channels == 2 ? src[i * 2 + 1] : 255;
+            }
+            break;
+    }
+}
+
+void PixelConverter::expandRGBToBGRA(const unsigned char* src, unsigned char* dst, size_t num_pixels) {
+    size_t i = 0;
+
+#ifdef __SSSE3__
+    // 4 pixels per step: 12 source bytes spread to 16, alpha filled by the OR
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+    // 16-byte loads read 4 bytes past the 4 pixels, stop early enough to stay in the buffer
+    for (; i + 6 <= num_pixels; i += 4) {
+        __m128i rgb = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        __m128i bgra = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), bgra);
+    }
+#endif
+
+    for (; i < num_pixels; i++) {
+        dst[i * 4] = src[i * 3 + 2];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+void PixelConverter::swizzleRGBAToBGRA(const unsigned char* src, unsigned char* dst, size_t num_pixels) {
+    size_t i = 0;
+
+#ifdef __SSSE3__
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    for (; i + 4 <= num_pixels; i += 4) {
+        __m128i rgba = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(rgba, shuffle));
+    }
+#endif
+
+    for (; i < num_pixels; i++) {
+        dst[i * 4] = src[i * 4 + 2];
+        dst[i * 4 + 1] = src[i * 4 + 1];
+        dst[i * 4 + 2] = src[i * 4];
+        dst[i * 4 + 3] = src[i * 4 + 3];
+    }
+}
+
+void PixelConverter::normalizeVectors(unsigned char* data, int n_channels, size_t num_pixels) {
+    if (n_channels < 3) {
+        return;
+    }
+
+    for (size_t i = 0; i < num_pixels; i++) {
+        unsigned char* p = data + i * n_channels;
+        float x = p[0] / 127.5f - 1.0f;
+        float y = p[1] / 127.5f - 1.0f;
+        float z = p[2] / 127.5f - 1.0f;
+        float length = sqrtf(x * x + y * y + z * z);
+        if (length < 1e-6f) {
+            continue;
+        }
+        p[0] = (unsigned char)lroundf((x / length + 1.0f) * 127.5f);
+        p[1] = (unsigned char)lroundf((y / length + 1.0f) * 127.5f);
+        p[2] = (unsigned char)lroundf((z / length + 1.0f) * 127.5f);
+    }
+}
+
+void PixelConverter::extractRG(const unsigned char* src, int n_channels, unsigned char* dst, size_t num_pixels) {
+    size_t i = 0;
+
+#ifdef __SSSE3__
+    if (n_channels == 3) {
+        // 8 pixels per step: 24 source bytes (two loads) to 16
+        const __m128i shuffle_lo = _mm_setr_epi8(0, 1, 3, 4, 6, 7, 9, 10, 12, 13, 15, -1, -1, -1, -1, -1);
+        const __m128i shuffle_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 2, 3, 5, 6);
+        for (; i + 8 <= num_pixels; i += 8) {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(src + i * 3));
+            __m128i hi = _mm_loadl_epi64((const __m128i*)(src + i * 3 + 16));
+            __m128i rg = _mm_or_si128(_mm_shuffle_epi8(lo, shuffle_lo), _mm_shuffle_epi8(hi, shuffle_hi));
+            _mm_storeu_si128((__m128i*)(dst + i * 2), rg);
+        }
+    } else if (n_channels == 4) {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        for (; i + 4 <= num_pixels; i += 4) {
+            __m128i rgba = _mm_loadu_si128((const __m128i*)(src + i * 4));
+            _mm_storel_epi64((__m128i*)(dst + i * 2), _mm_shuffle_epi8(rgba, shuffle));
+        }
+    }
+#endif
+
+    for (; i < num_pixels; i++) {
+        dst[i * 2] = src[i * n_channels];
+        dst[i * 2 + 1] = n_channels > 1 ? src[i * n_channels + 1] : src[i * n_channels];
+    }
+}
+
+static std::array<unsigned char, 256> buildSrgbLut() {
+    std::array<unsigned char, 256> lut;
+    for (int v = 0; v < 256; v++) {
+        float c = v / 255.0f;
+        float linear = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        lut[v] = (unsigned char)(linear * 255.0f + 0.5f);
+    }
+    return lut;
+}
+
+void PixelConverter::srgbToLinear(unsigned char* data, int n_channels, size_t num_pixels) {
+    // Built once, thread-safe for the decoding workers
+    static const std::array<unsigned char, 256> lut = buildSrgbLut();
+
+    int color_channels = n_channels == 4 ? 3 : n_channels;
+    for (size_t i = 0; i < num_pixels; i++) {
+        for (int c = 0; c < color_channels; c++) {
+            data[i * n_channels + c] = lut[data[i * n_channels + c]];
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "SceneGraph.hpp"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace glm;
+
+SceneGraph::SceneGraph() {
+    any_dirty = false;
+    num_updated = 0;
+}
+
+unsigned int SceneGraph::addNode(int parent, const mat4& local, SceneMesh* mesh) {
+    if (parent != NO_PARENT && (parent < 0 || parent >= (int)parents.size())) {
+        cerr << "Scene graph parent " << parent << " does not exist!" << endl;
+        exit(-1);
+    }
+
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(local);
+    meshes.push_back(mesh);
+    dirty.push_back(1);
+    any_dirty = true;
+    return (unsigned int)parents.size() - 1;
+}
+
+void SceneGraph::clear() {
+    parents.clear();
+    locals.clear();
+    worlds.clear();
+    meshes.clear();
+    dirty.clear();
+    any_dirty = false;
+}
+
+void SceneGraph::setLocalTransform(unsigned int node, const mat4& local) {
+    locals[node] = local;
+    dirty[node] = 1;
+    any_dirty = true;
+}
+
+void SceneGraph::update() {
+    num_updated = 0;
+    if (!any_dirty) {
+        return;
+    }
+
+    // Parents come first, so a dirty parent has already marked and updated its children's input
+    for (size_t i = 0; i < parents.size(); i++) {
+        int parent = parents[i];
+        if (parent != NO_PARENT) {
+            dirty[i] |= dirty[parent];
+        }
+        if (!dirty[i]) {
+            continue;
+        }
+        worlds[i] = parent == NO_PARENT ? locals[i] : worlds[parent] * locals[i];
+        num_updated++;
+    }
+
+    // Cleared afterwards, children read their parent's flag during the pass
+    fill(dirty.begin(), dirty.end(), 0);
+    any_dirty = false;
+}
+
+unsigned int SceneGraph::getNumNodes() const { return (unsigned int)parents.size(); }
+int SceneGraph::getParent(unsigned int node) const { return parents[node]; }
+SceneMesh* SceneGraph::getMesh(unsigned int node) const { return meshes[node]; }
+const mat4& SceneGraph::getLocalTransform(unsigned int node) const { return locals[node]; }
+const mat4& SceneGraph::getWorldTransform(unsigned int node) const { return worlds[node]; }
+unsigned int SceneGraph::getNumUpdated() const { return num_updated; }
@@ -7,10 +7,13 @@
 #include <assimp/postprocess.h>
 #include <utils.hpp>
 
+#include "TangentGenerator.hpp"
+#include "bvh.h"
+
 using namespace std;
 using namespace glm;
 
-#define ASSIMP_PROCESSING_FLAGS aiProcess_Triangulate | aiProcess_GenBoundingBoxes | aiProcess_GenSmoothNormals
+#define ASSIMP_PROCESSING_FLAGS aiProcess_JoinIdenticalVertices | aiProcess_Triangulate | aiProcess_GenBoundingBoxes | aiProcess_GenSmoothNormals
 
 const float min_float = numeric_limits<float>::min();
 const float max_float = numeric_limits<float>::max();
@@ -19,6 +22,8 @@ SceneMesh::SceneMesh() {
     center = vec3{ 0.0f, 0.0f, 0.0f };
     bound_box_max = vec3{ min_float, min_float, min_float };
     bound_box_min = vec3{ max_float, max_float, max_float };
+    pivot = center;
+    bounds_dirty = true;
 
     _translation = vec3{ 0.0f, 0.0f, 0.0f };
     _rotation = vec3{ 0.0f, 0.0f, 0.0f };
@@ -32,14 +37,15 @@ SceneMesh::SceneMesh() {
     scene = nullptr;
 }
 
-void SceneMesh::load(const string mesh_path) {
+void SceneMesh::load(const string mesh_path, bool upload_buffers) {
     cout << "Reading mesh from file: " << mesh_path << endl;
     scene = importer.ReadFile(mesh_path, ASSIMP_PROCESSING_FLAGS);
 
-    loadModel();
+    loadModel(upload_buffers);
+    bounds_dirty = true;
 }
 
-void SceneMesh::loadModel() {
+void SceneMesh::loadModel(bool upload_buffers) {
     if (!scene || !scene->mRootNode || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
         cout << "Assimp importer.ReadFile (Error) -- " << importer.GetErrorString() << "\n";
         exit(-1);
@@ -62,6 +68,8 @@ void SceneMesh::loadModel() {
             bound_box_max = glm::max(bound_box_max, mesh_max);
             bound_box_min = glm::min(bound_box_min, mesh_min);
 
+            mesh_list[i].bound_box_max = mesh_max;
+            mesh_list[i].bound_box_min = mesh_min;
             mesh_list[i].center = (mesh_max + mesh_min) / 2.0f;
             center += mesh_list[i].center;
 
@@ -77,23 +85,24 @@ void SceneMesh::loadModel() {
                 } else {
                     mesh_list[i].vert_normals.push_back(vec3(0.0f, 0.0f, 0.0f));
                 }
-
-                mesh_list[i].vert_tangents.push_back(vec3(0.0f, 0.0f, 0.0f));
             }
 
             // (3) Loop through all mesh [i]'s Indices
             // --------------------------------------------------
-            // for (unsigned int i3 = 0; i3 < mesh->mNumFaces; ++i3) {
-            //     for (unsigned int i4 = 0; i4 < mesh->mFaces[i3].mNumIndices; ++i4) {
-            //         mesh_list[i].vert_indices.push_back(mesh->mFaces[i3].mIndices[i4]);
-            //     }
-            // }
+            for (unsigned int i3 = 0; i3 < mesh->mNumFaces; ++i3) {
+                for (unsigned int i4 = 0; i4 < mesh->mFaces[i3].mNumIndices; ++i4) {
+                    mesh_list[i].vert_indices.push_back(mesh->mFaces[i3].mIndices[i4]);
+                }
+            }
 
             calcTangentSpace(i);
-            setBufferData(i);   // Set up: VAO, VBO and EBO.
+            if (upload_buffers) {
+                setBufferData(i);   // Set up: VAO, VBO and EBO.
+            }
         }
 
         center /= (float)num_meshes;
+        pivot = center;
     }
 }
 
@@ -125,55 +134,25 @@ void SceneMesh::setBufferData(unsigned int index) {
     // Vertex Tangents
     // --------------------
     glBindBuffer(GL_ARRAY_BUFFER, mesh_list[index].VBO3);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * mesh_list[index].vert_tangents.size(), &mesh_list[index].vert_tangents[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vec4) * mesh_list[index].vert_tangents.size(), &mesh_list[index].vert_tangents[0], GL_STATIC_DRAW);
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(2);   // w is the bitangent sign
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 
     // Indices for: glDrawElements()
     // ---------------------------------------
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_list[index].EBO);
-    // glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh_list[index].vert_indices.size(), &mesh_list[index].vert_indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_list[index].EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * mesh_list[index].vert_indices.size(), &mesh_list[index].vert_indices[0], GL_STATIC_DRAW);
 
     glBindVertexArray(0);   // Unbind VAO
 }
 
 void SceneMesh::calcTangentSpace(unsigned int index) {
-    int i = 0;
-    int i1, i2, i3;
-    float f;
-    vec3 pos1, pos2, pos3, edge1, edge2, tan;
-    vec2 uv1, uv2, uv3, deltaUV1, deltaUV2;
-
-    while (i < mesh_list[index].vert_positions.size()) {
-        i1 = i++;
-        i2 = i++;
-        i3 = i++;
-
-        pos1 = mesh_list[index].vert_positions[i1];
-        pos2 = mesh_list[index].vert_positions[i2];
-        pos3 = mesh_list[index].vert_positions[i3];
-
-        vec3 mesh_center = mesh_list[index].center;
-        uv1 = toCubeUV(pos1 - mesh_center, mesh_list[index].vert_normals[i1]);
-        uv2 = toCubeUV(pos2 - mesh_center, mesh_list[index].vert_normals[i2]);
-        uv3 = toCubeUV(pos3 - mesh_center, mesh_list[index].vert_normals[i3]);
-
-        edge1 = pos2 - pos1;
-        edge2 = pos3 - pos1;
-        deltaUV1 = uv2 - uv1;
-        deltaUV2 = uv3 - uv1;
-
-        f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tan.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tan.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tan.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-        mesh_list[index].vert_tangents[i1] += tan;
-        mesh_list[index].vert_tangents[i2] += tan;
-        mesh_list[index].vert_tangents[i3] += tan;
-    }
+    Mesh& mesh = mesh_list[index];
+    size_t num_vertices = mesh.vert_positions.size();
+
+    TangentGenerator::generate(mesh.vert_positions, mesh.vert_normals, mesh.vert_indices, mesh.center, &mesh.vert_tangents);
+    cout << "Mesh " << index << ": " << mesh.vert_indices.size() / 3 << " triangles, " << num_vertices << " vertices (" << mesh.vert_positions.size() - num_vertices << " split on seams)" << endl;
 }
 
 void SceneMesh::translate(glm::vec3 translation) {
@@ -184,10 +163,13 @@ void SceneMesh::translate(glm::vec3 translation) {
 
 void SceneMesh::rotate(float degrees, glm::vec3 axis) {
     _rotation += axis * degrees;
-    mat4 from_center = glm::translate(mat4{ 1.0f }, -center);
+
+    // Where the pivot is after the previous rotations (the center stays in place)
+    vec3 rotated_pivot = vec3(rotation_mat * scale_mat * vec4(pivot, 1.0f));
+    mat4 from_pivot = glm::translate(mat4{ 1.0f }, -rotated_pivot);
     mat4 rot = glm::rotate(mat4{ 1.0f }, radians(degrees), axis);
-    mat4 to_center = glm::translate(mat4{ 1.0f }, center);
-    rotation_mat = to_center * rot * from_center * rotation_mat;
+    mat4 to_pivot = glm::translate(mat4{ 1.0f }, rotated_pivot);
+    rotation_mat = to_pivot * rot * from_pivot * rotation_mat;
     updateTransformation();
 }
 
@@ -200,13 +182,58 @@ void SceneMesh::scale(glm::vec3 scale) {
     updateTransformation();
 }
 
+void SceneMesh::setPivot(glm::vec3 pivot) {
+    this->pivot = pivot;
+}
+
 void SceneMesh::updateTransformation() {
     transformation_mat = translation_mat * rotation_mat * scale_mat;
+    bounds_dirty = true;
+}
+
+void SceneMesh::refitBounds() const {
+    if (!bounds_dirty) {
+        return;
+    }
+
+    // From the model space boxes of each mesh, the scene box is their union
+    mesh_box_max.resize(mesh_list.size());
+    mesh_box_min.resize(mesh_list.size());
+    transformed_box_max = vec3{ -max_float, -max_float, -max_float };
+    transformed_box_min = vec3{ max_float, max_float, max_float };
+    for (size_t i = 0; i < mesh_list.size(); i++) {
+        transformBoundBox(transformation_mat, mesh_list[i].bound_box_min, mesh_list[i].bound_box_max, &mesh_box_min[i], &mesh_box_max[i]);
+        transformed_box_max = glm::max(transformed_box_max, mesh_box_max[i]);
+        transformed_box_min = glm::min(transformed_box_min, mesh_box_min[i]);
+    }
+    bounds_dirty = false;
 }
 
 unsigned int SceneMesh::getNumMeshes() const { return num_meshes; }
-std::vector<Mesh> SceneMesh::getMeshList() const { return mesh_list; }
+void SceneMesh::buildBVH(TriangleBVH* bvh, int num_threads) const {
+    bvh->clear();
+    for (const Mesh& mesh : mesh_list) {
+        bvh->addMesh(mesh.vert_positions, mesh.vert_indices);
+    }
+    bvh->build(num_threads);
+}
+
+const std::vector<Mesh>& SceneMesh::getMeshList() const { return mesh_list; }
 glm::vec3 SceneMesh::getCenter() const { return center; }
-glm::vec3 SceneMesh::getBoundBoxMax() const { return bound_box_max; }
-glm::vec3 SceneMesh::getBoundBoxMin() const { return bound_box_min; }
+glm::vec3 SceneMesh::getPivot() const { return pivot; }
+glm::vec3 SceneMesh::getBoundBoxMax() const {
+    refitBounds();
+    return transformed_box_max;
+}
+
+glm::vec3 SceneMesh::getBoundBoxMin() const {
+    refitBounds();
+    return transformed_box_min;
+}
+
+void SceneMesh::getMeshBoundBox(unsigned int index, glm::vec3* box_min, glm::vec3* box_max) const {
+    refitBounds();
+    *box_min = mesh_box_min[index];
+    *box_max = mesh_box_max[index];
+}
 glm::mat4 SceneMesh::getTransformation() const { return transformation_mat; }
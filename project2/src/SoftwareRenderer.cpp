@@ -0,0 +1,536 @@
+#include "SoftwareRenderer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <utils.hpp>
+
+#include "PixelConverter.hpp"
+#include "TextureCompressor.hpp"
+#include "stb_image.h"
+
+using namespace std;
+using namespace glm;
+
+// Guard band as a multiple of w, triangles inside it are scissored instead of clipped
+#define GUARD_BAND 4.0f
+
+// Smaller batches are not worth the thread start up
+#define MIN_ITEMS_PER_THREAD 4096
+
+// Attributes interpolated for each color mode
+#define LIGHT_ATTRIBUTES 6
+#define TEXT_ATTRIBUTES 9
+#define NORMAL_ATTRIBUTES 12
+
+// Stored zlib blocks, the largest a deflate block can hold
+#define PNG_BLOCK_SIZE 65535
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, int num_threads) {
+    this->width = width;
+    this->height = height;
+    this->num_threads = std::max(1, num_threads);
+
+    tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            Tile tile;
+            tile.x = tx * TILE_SIZE;
+            tile.y = ty * TILE_SIZE;
+            tile.width = std::min(TILE_SIZE, width - tile.x);
+            tile.height = std::min(TILE_SIZE, height - tile.y);
+            tile.color.resize((size_t)tile.width * tile.height * 3);
+            tile.depth.resize((size_t)tile.width * tile.height);
+            tiles.push_back(tile);
+        }
+    }
+
+    triangles.resize(this->num_threads);
+    bins.resize(this->num_threads, vector<vector<unsigned int>>(tiles.size()));
+
+    clipper = TriangleClipper(GUARD_BAND);
+    num_attributes = LIGHT_ATTRIBUTES;
+    is_flat = false;
+    has_normal_map = false;
+    num_triangles = 0;
+}
+
+void SoftwareRenderer::loadMaterial(const string text_file, const string normal_map_file, bool is_flat) {
+    this->is_flat = is_flat;
+    if (!loadImage(text_file, false, !is_flat, &diffuse_map, &diffuse_faces)) {
+        cerr << "Failed to read texture file: " << text_file << endl;
+        exit(-1);
+    }
+
+    ifstream f(normal_map_file.c_str());
+    has_normal_map = f.good();
+    if (has_normal_map && !loadImage(normal_map_file, true, !is_flat, &normal_map, &normal_faces)) {
+        cerr << "Failed to read texture file: " << normal_map_file << endl;
+        exit(-1);
+    }
+}
+
+bool SoftwareRenderer::hasNormalMap() const {
+    return has_normal_map;
+}
+
+bool SoftwareRenderer::loadImage(const string filename, bool is_normal_map, bool is_cube, Image* image, vector<Image>* faces) {
+    int im_width, im_height, n_channels;
+    unsigned char* im_data = stbi_load(filename.c_str(), &im_width, &im_height, &n_channels, 3);
+    if (!im_data) {
+        return false;
+    }
+
+    // Same preprocessing as the uploaded normal maps
+    if (is_normal_map) {
+        PixelConverter::normalizeVectors(im_data, 3, (size_t)im_width * im_height);
+    }
+
+    image->width = im_width;
+    image->height = im_height;
+    image->pixels.assign(im_data, im_data + (size_t)im_width * im_height * 3);
+    stbi_image_free(im_data);
+
+    faces->clear();
+    if (!is_cube) {
+        return true;
+    }
+    if (im_height % 3 != 0 || im_width % 4 != 0) {
+        cerr << "Texture file " << filename << " size does not match with cubemap" << endl;
+        return false;
+    }
+
+    // Faces cut from the 4x3 atlas, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+    int face_width = im_width / 4;
+    int face_height = im_height / 3;
+    faces->resize(6);
+    for (int i = 0; i < 6; i++) {
+        Image& face = (*faces)[i];
+        face.width = face_width;
+        face.height = face_height;
+        face.pixels.resize((size_t)face_width * face_height * 3);
+        for (int row = 0; row < face_height; row++) {
+            size_t src = ((size_t)(cube_face_offsets[i][1] * face_height + row) * im_width + cube_face_offsets[i][0] * face_width) * 3;
+            memcpy(&face.pixels[(size_t)row * face_width * 3], &image->pixels[src], face_width * 3);
+        }
+    }
+    return true;
+}
+
+void SoftwareRenderer::render(const vector<Mesh>& meshes, const ShadingParams& params) {
+    switch (params.color_mode) {
+        case LIGHTNING_MODE:
+            num_attributes = LIGHT_ATTRIBUTES;
+            break;
+        case TEXTURE_MODE:
+            num_attributes = TEXT_ATTRIBUTES;
+            break;
+        default:
+            num_attributes = NORMAL_ATTRIBUTES;
+            break;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        triangles[t].clear();
+        for (vector<unsigned int>& bin : bins[t]) {
+            bin.clear();
+        }
+    }
+    mesh_ends.clear();
+
+    // (1) Vertex shading, then clipping and binning, one mesh at a time
+    num_triangles = 0;
+    for (const Mesh& mesh : meshes) {
+        vertices.resize(mesh.vert_positions.size());
+        parallelFor(vertices.size(), [&](size_t first, size_t last, int) {
+            transformVertices(mesh, params, first, last);
+        });
+
+        size_t mesh_triangles = mesh.vert_indices.size() / 3;
+        parallelFor(mesh_triangles, [&](size_t first, size_t last, int thread) {
+            binTriangles(mesh, first, last, thread);
+        });
+        num_triangles += mesh_triangles;
+
+        vector<unsigned int> ends(num_threads);
+        for (int t = 0; t < num_threads; t++) {
+            ends[t] = (unsigned int)triangles[t].size();
+        }
+        mesh_ends.push_back(ends);
+    }
+
+    // (2) Tiles are handed out to the workers as they finish, center tiles cost more
+    atomic<size_t> next_tile{ 0 };
+    vector<future<void>> workers;
+    for (int t = 0; t < num_threads; t++) {
+        workers.push_back(async(launch::async, [&]() {
+            for (size_t i = next_tile++; i < tiles.size(); i = next_tile++) {
+                rasterizeTile(tiles[i], params);
+            }
+        }));
+    }
+    for (future<void>& w : workers) {
+        w.get();
+    }
+}
+
+void SoftwareRenderer::transformVertices(const Mesh& mesh, const ShadingParams& params, size_t first, size_t last) {
+    mat4 model_view_projection = params.projection * params.view * params.model;
+    mat3 normal_mat = mat3(transpose(inverse(params.model)));
+
+    for (size_t i = first; i < last; i++) {
+        vec3 position = mesh.vert_positions[i];
+        vec3 normal = mesh.vert_normals[i];
+        vec3 world_position = vec3(params.model * vec4(position, 1.0f));
+        ClipVertex& out = vertices[i];
+        out.position = model_view_projection * vec4(position, 1.0f);
+
+        if (params.color_mode != TEXTURE_NORMAL_MODE) {
+            // light_vtx.glsl / text_vtx.glsl
+            vec3 n = normal_mat * normal;
+            float* a = out.attributes;
+            a[0] = n.x, a[1] = n.y, a[2] = n.z;
+            a[3] = world_position.x, a[4] = world_position.y, a[5] = world_position.z;
+            a[6] = position.x, a[7] = position.y, a[8] = position.z;
+            continue;
+        }
+
+        // normal_vtx.glsl
+        vec4 tangent = mesh.vert_tangents[i];
+        vec3 T = normalize(normal_mat * vec3(tangent));
+        vec3 N = normalize(normal_mat * normal);
+        T = normalize(T - dot(T, N) * N);
+        vec3 B = cross(N, T) * tangent.w;
+        mat3 TBN = transpose(mat3(T, B, N));
+
+        vec3 values[4] = { position, TBN * params.light_position, TBN * params.camera_position, TBN * world_position };
+        for (int k = 0; k < 4; k++) {
+            out.attributes[k * 3] = values[k].x;
+            out.attributes[k * 3 + 1] = values[k].y;
+            out.attributes[k * 3 + 2] = values[k].z;
+        }
+    }
+}
+
+void SoftwareRenderer::binTriangles(const Mesh& mesh, size_t first, size_t last, int thread) {
+    ClipPolygon polygon;
+    for (size_t t = first; t < last; t++) {
+        const ClipVertex& v0 = vertices[mesh.vert_indices[t * 3]];
+        const ClipVertex& v1 = vertices[mesh.vert_indices[t * 3 + 1]];
+        const ClipVertex& v2 = vertices[mesh.vert_indices[t * 3 + 2]];
+
+        ClipResult result = clipper.clip(v0, v1, v2, num_attributes, &polygon);
+        if (result == CLIP_REJECTED) {
+            continue;
+        }
+
+        // Clipped polygons are convex, drawn as a fan
+        for (int i = 1; i + 1 < polygon.size; i++) {
+            setupTriangle(polygon.vertices[0], polygon.vertices[i], polygon.vertices[i + 1], thread);
+        }
+    }
+}
+
+void SoftwareRenderer::setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, int thread) {
+    Triangle triangle;
+    vec2 screen[3];
+    float z[3];
+    const ClipVertex* v[3] = { &v0, &v1, &v2 };
+    for (int k = 0; k < 3; k++) {
+        // Viewport transform, the first row is the top of the image
+        float inv_w = 1.0f / v[k]->position.w;
+        vec3 ndc = vec3(v[k]->position) * inv_w;
+        screen[k] = vec2((ndc.x * 0.5f + 0.5f) * width, (0.5f - ndc.y * 0.5f) * height);
+        z[k] = ndc.z * 0.5f + 0.5f;
+        triangle.inv_w[k] = inv_w;
+        for (int a = 0; a < num_attributes; a++) {
+            triangle.attributes[k][a] = v[k]->attributes[a] * inv_w;
+        }
+    }
+
+    // Snapped to fixed point, degenerate triangles are dropped
+    if (!setupHalfSpace(screen, z, &triangle.edges)) {
+        return;
+    }
+    int min_x = std::max(0, triangle.edges.min_x);
+    int min_y = std::max(0, triangle.edges.min_y);
+    int max_x = std::min(width - 1, triangle.edges.max_x);
+    int max_y = std::min(height - 1, triangle.edges.max_y);
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+
+    unsigned int index = (unsigned int)triangles[thread].size();
+    triangles[thread].push_back(triangle);
+    for (int ty = min_y / TILE_SIZE; ty <= max_y / TILE_SIZE; ty++) {
+        for (int tx = min_x / TILE_SIZE; tx <= max_x / TILE_SIZE; tx++) {
+            bins[thread][ty * tiles_x + tx].push_back(index);
+        }
+    }
+}
+
+void SoftwareRenderer::rasterizeTile(Tile& tile, const ShadingParams& params) {
+    unsigned char background[3];
+    for (int c = 0; c < 3; c++) {
+        background[c] = (unsigned char)(glm::clamp(params.background_color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    for (size_t p = 0; p < tile.depth.size(); p++) {
+        memcpy(&tile.color[p * 3], background, 3);
+    }
+    fill(tile.depth.begin(), tile.depth.end(), 1.0f);
+
+    // Submission order: meshes in order, and within a mesh threads in order (each bins a
+    // contiguous range of it). Equal depths then keep the first triangle, like GL_LESS
+    vector<RasterBlock> blocks;
+    size_t tile_index = (tile.y / TILE_SIZE) * tiles_x + tile.x / TILE_SIZE;
+    vector<size_t> cursor(num_threads, 0);
+    for (const vector<unsigned int>& ends : mesh_ends) {
+        for (int t = 0; t < num_threads; t++) {
+            const vector<unsigned int>& bin = bins[t][tile_index];
+            for (; cursor[t] < bin.size() && bin[cursor[t]] < ends[t]; cursor[t]++) {
+                rasterizeTriangle(triangles[t][bin[cursor[t]]], tile, params, blocks);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::rasterizeTriangle(const Triangle& triangle, Tile& tile, const ShadingParams& params, vector<RasterBlock>& blocks) {
+    // Coverage, depth and barycentrics of 8x1 blocks from the half-space kernel
+    blocks.clear();
+    rasterizeBlocks(triangle.edges, BLOCK_8X1, tile.x, tile.y, tile.x + tile.width - 1, tile.y + tile.height - 1, &blocks);
+
+    float attributes[CLIP_MAX_ATTRIBUTES];
+    for (const RasterBlock& block : blocks) {
+        size_t row = (size_t)(block.y - tile.y) * tile.width;
+        for (int i = 0; i < 8; i++) {
+            if (!(block.mask & (1u << i))) {
+                continue;
+            }
+            size_t p = row + block.x + i - tile.x;
+            if (block.z[i] >= tile.depth[p]) {
+                continue;
+            }
+            tile.depth[p] = block.z[i];
+
+            // Attributes were divided by w, perspective correct after dividing by the interpolated 1/w
+            float l1 = block.l1[i], l2 = block.l2[i], l0 = 1.0f - l1 - l2;
+            float w = 1.0f / (l0 * triangle.inv_w[0] + l1 * triangle.inv_w[1] + l2 * triangle.inv_w[2]);
+            for (int a = 0; a < num_attributes; a++) {
+                attributes[a] = (l0 * triangle.attributes[0][a] + l1 * triangle.attributes[1][a] + l2 * triangle.attributes[2][a]) * w;
+            }
+
+            vec3 color = glm::clamp(shade(attributes, params), 0.0f, 1.0f) * 255.0f + 0.5f;
+            tile.color[p * 3] = (unsigned char)color.r;
+            tile.color[p * 3 + 1] = (unsigned char)color.g;
+            tile.color[p * 3 + 2] = (unsigned char)color.b;
+        }
+    }
+}
+
+// Same terms as the fragment shaders
+static vec3 phong(vec3 n, vec3 l, vec3 v, vec3 light_color) {
+    float ka = 0.1f;
+    vec3 ambient = ka * light_color;
+
+    float kd = 0.5f;
+    float diff = std::max(dot(n, l), 0.0f);
+    vec3 diffuse = kd * diff * light_color;
+
+    float ks = 0.8f;
+    vec3 r = reflect(-l, n);
+    float spec = pow(std::max(dot(v, r), 0.0f), 32.0f);
+    vec3 specular = ks * spec * light_color;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 SoftwareRenderer::shade(const float* a, const ShadingParams& params) const {
+    if (params.color_mode != TEXTURE_NORMAL_MODE) {
+        // light_frag.glsl / text_frag.glsl / text_flat_frag.glsl
+        vec3 n = normalize(vec3(a[0], a[1], a[2]));
+        vec3 frag_pos(a[3], a[4], a[5]);
+        vec3 l = normalize(params.light_position - frag_pos);
+        vec3 v = normalize(params.camera_position - frag_pos);
+
+        vec3 object_color = params.object_color;
+        if (params.color_mode == TEXTURE_MODE) {
+            object_color = sampleCube(diffuse_faces, diffuse_map, vec3(a[6], a[7], a[8]) - params.object_center);
+        }
+        return phong(n, l, v, params.light_color) * object_color;
+    }
+
+    // normal_frag.glsl / normal_flat_frag.glsl
+    vec3 text_coord = vec3(a[0], a[1], a[2]) - params.object_center;
+    vec3 tan_light_pos(a[3], a[4], a[5]);
+    vec3 tan_camera_pos(a[6], a[7], a[8]);
+    vec3 tan_frag_pos(a[9], a[10], a[11]);
+
+    vec3 normal_rgb = sampleCube(normal_faces, normal_map, text_coord);
+    vec2 normal_xy = vec2(normal_rgb) * 2.0f - 1.0f;
+    vec3 normal(normal_xy.x, -normal_xy.y, sqrt(std::max(1.0f - dot(normal_xy, normal_xy), 0.0f)));
+
+    vec3 n = normalize(normal);
+    vec3 l = normalize(tan_light_pos - tan_frag_pos);
+    vec3 v = normalize(tan_camera_pos - tan_frag_pos);
+    return phong(n, l, v, params.light_color) * sampleCube(diffuse_faces, diffuse_map, text_coord);
+}
+
+vec3 SoftwareRenderer::sampleCube(const vector<Image>& faces, const Image& flat, vec3 dir) const {
+    // cubeFaceUV has v going up, texture rows go down like GL's t
+    int face = cubeFace(dir);
+    vec2 uv = cubeFaceUV(dir, face);
+    return sampleBilinear(is_flat ? flat : faces[face], uv.x, 1.0f - uv.y);
+}
+
+vec3 SoftwareRenderer::sampleBilinear(const Image& image, float u, float v) {
+    // Base level only, clamped to the edges
+    float x = u * image.width - 0.5f;
+    float y = v * image.height - 0.5f;
+    int x0 = (int)floor(x), y0 = (int)floor(y);
+    float fx = x - x0, fy = y - y0;
+
+    vec3 texels[4];
+    for (int k = 0; k < 4; k++) {
+        int tx = glm::clamp(x0 + (k & 1), 0, image.width - 1);
+        int ty = glm::clamp(y0 + (k >> 1), 0, image.height - 1);
+        const unsigned char* p = &image.pixels[((size_t)ty * image.width + tx) * 3];
+        texels[k] = vec3(p[0], p[1], p[2]);
+    }
+    vec3 top = texels[0] + (texels[1] - texels[0]) * fx;
+    vec3 bottom = texels[2] + (texels[3] - texels[2]) * fx;
+    return (top + (bottom - top) * fy) / 255.0f;
+}
+
+bool SoftwareRenderer::writeImage(const string filename) const {
+    // Tiles back to rows
+    vector<unsigned char> rgb((size_t)width * height * 3);
+    for (const Tile& tile : tiles) {
+        for (int row = 0; row < tile.height; row++) {
+            memcpy(&rgb[((size_t)(tile.y + row) * width + tile.x) * 3], &tile.color[(size_t)row * tile.width * 3], tile.width * 3);
+        }
+    }
+
+    string ext = filename.substr(filename.find_last_of('.') + 1);
+    if (ext == "png") {
+        return writePNG(filename, rgb);
+    }
+    return writePPM(filename, rgb);
+}
+
+bool SoftwareRenderer::writePPM(const string filename, const vector<unsigned char>& rgb) const {
+    ofstream file(filename, ios::binary);
+    if (!file.good()) {
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write((const char*)rgb.data(), rgb.size());
+    return file.good();
+}
+
+static unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc) {
+    static unsigned int table[256];
+    if (table[1] == 0) {
+        for (unsigned int n = 0; n < 256; n++) {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(vector<unsigned char>& out, unsigned int value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((unsigned char)(value >> shift));
+    }
+}
+
+static void appendChunk(vector<unsigned char>& png, const char* type, const vector<unsigned char>& data) {
+    appendBigEndian(png, (unsigned int)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    appendBigEndian(png, crc32(&png[start], png.size() - start, 0));
+}
+
+bool SoftwareRenderer::writePNG(const string filename, const vector<unsigned char>& rgb) const {
+    // Rows with filter type 0 (none)
+    vector<unsigned char> raw;
+    raw.reserve((size_t)(width * 3 + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + (size_t)y * width * 3, rgb.begin() + (size_t)(y + 1) * width * 3);
+    }
+
+    // zlib stream of stored (uncompressed) deflate blocks
+    vector<unsigned char> idat = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += PNG_BLOCK_SIZE) {
+        size_t size = std::min<size_t>(PNG_BLOCK_SIZE, raw.size() - offset);
+        idat.push_back(offset + size == raw.size() ? 1 : 0);
+        idat.push_back(size & 0xFF);
+        idat.push_back(size >> 8);
+        idat.push_back(~size & 0xFF);
+        idat.push_back((~size >> 8) & 0xFF);
+        idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    unsigned int s1 = 1, s2 = 0;
+    for (unsigned char c : raw) {
+        s1 = (s1 + c) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    appendBigEndian(idat, (s2 << 16) | s1);
+
+    vector<unsigned char> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });   // 8 bit RGB
+
+    vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", idat);
+    appendChunk(png, "IEND", vector<unsigned char>());
+
+    ofstream file(filename, ios::binary);
+    file.write((const char*)png.data(), png.size());
+    return file.good();
+}
+
+size_t SoftwareRenderer::getNumTriangles() const {
+    return num_triangles;
+}
+
+size_t SoftwareRenderer::getNumRasterized() const {
+    size_t count = 0;
+    for (const vector<Triangle>& thread_triangles : triangles) {
+        count += thread_triangles.size();
+    }
+    return count;
+}
+
+void SoftwareRenderer::parallelFor(size_t count, const function<void(size_t, size_t, int)>& task) const {
+    int threads = (int)std::max<size_t>(1, std::min<size_t>(num_threads, count / MIN_ITEMS_PER_THREAD));
+    if (threads == 1) {
+        task(0, count, 0);
+        return;
+    }
+
+    vector<future<void>> tasks;
+    size_t chunk = (count + threads - 1) / threads;
+    for (int i = 0; i < threads; i++) {
+        size_t first = std::min(count, i * chunk);
+        size_t last = std::min(count, first + chunk);
+        tasks.push_back(async(launch::async, task, first, last, i));
+    }
+    for (future<void>& f : tasks) {
+        f.get();
+    }
+}
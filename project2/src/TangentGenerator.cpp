@@ -0,0 +1,184 @@
+#include "TangentGenerator.hpp"
+#include <future>
+#include <thread>
+#include <utils.hpp>
+
+using namespace std;
+using namespace glm;
+
+// Smaller meshes are not worth the thread start up
+#define MIN_TRIANGLES_PER_THREAD 8192
+
+// Split keys: 6 cube faces times 2 handedness signs
+#define NUM_SEAM_KEYS 12
+
+void TangentGenerator::generate(vector<vec3>& positions, vector<vec3>& normals, vector<unsigned int>& indices, vec3 center, vector<vec4>* tangents) {
+    size_t num_triangles = indices.size() / 3;
+
+    // (1) Cube face, handedness and UV tangent of each triangle
+    vector<vec3> triangle_tangents(num_triangles);
+    vector<unsigned char> triangle_keys(num_triangles);
+    parallelFor(num_triangles, [&](size_t first, size_t last, int) {
+        computeTriangleFrames(positions, indices, center, first, last, triangle_tangents, triangle_keys);
+    });
+
+    // (2) Vertices shared across a face or handedness seam get one copy per side
+    splitSeams(positions, normals, indices, triangle_keys);
+
+    // (3) Each thread sums its triangles into its own buffer
+    int num_threads = numThreads(num_triangles);
+    vector<vector<vec3>> sums(num_threads);
+    parallelFor(num_triangles, [&](size_t first, size_t last, int thread) {
+        sums[thread].assign(positions.size(), vec3{ 0.0f });
+        accumulate(positions, normals, indices, triangle_tangents, first, last, sums[thread]);
+    });
+
+    // (4) Reduction over vertex ranges, then orthogonalize against the normal
+    vector<float> signs(positions.size(), 1.0f);
+    for (size_t t = 0; t < num_triangles; t++) {
+        float sign = (triangle_keys[t] & 1) ? -1.0f : 1.0f;
+        for (int k = 0; k < 3; k++) {
+            signs[indices[t * 3 + k]] = sign;
+        }
+    }
+
+    tangents->resize(positions.size());
+    parallelFor(positions.size(), [&](size_t first, size_t last, int) {
+        for (size_t v = first; v < last; v++) {
+            vec3 sum{ 0.0f };
+            for (const vector<vec3>& thread_sums : sums) {
+                if (!thread_sums.empty()) {
+                    sum += thread_sums[v];
+                }
+            }
+            (*tangents)[v] = vec4(orthogonalize(sum, normals[v]), signs[v]);
+        }
+    });
+}
+
+void TangentGenerator::computeTriangleFrames(const vector<vec3>& positions, const vector<unsigned int>& indices, vec3 center, size_t first, size_t last, vector<vec3>& triangle_tangents,
+                                             vector<unsigned char>& triangle_keys) {
+    for (size_t t = first; t < last; t++) {
+        vec3 pos1 = positions[indices[t * 3]];
+        vec3 pos2 = positions[indices[t * 3 + 1]];
+        vec3 pos3 = positions[indices[t * 3 + 2]];
+
+        // The whole triangle is projected on the face its centroid falls on
+        int face = cubeFace((pos1 + pos2 + pos3) / 3.0f - center);
+        vec2 uv1 = cubeFaceUV(pos1 - center, face);
+        vec2 uv2 = cubeFaceUV(pos2 - center, face);
+        vec2 uv3 = cubeFaceUV(pos3 - center, face);
+
+        vec3 edge1 = pos2 - pos1;
+        vec3 edge2 = pos3 - pos1;
+        vec2 delta_uv1 = uv2 - uv1;
+        vec2 delta_uv2 = uv3 - uv1;
+
+        float det = delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y;
+        if (abs(det) < 1e-12f) {
+            // Degenerate mapping, does not contribute
+            triangle_tangents[t] = vec3{ 0.0f };
+            triangle_keys[t] = face * 2;
+            continue;
+        }
+
+        float f = 1.0f / det;
+        vec3 tangent = f * (delta_uv2.y * edge1 - delta_uv1.y * edge2);
+        vec3 bitangent = f * (delta_uv1.x * edge2 - delta_uv2.x * edge1);
+
+        // Mirrored mapping when the bitangent points against cross(normal, tangent)
+        bool mirrored = dot(cross(cross(edge1, edge2), tangent), bitangent) < 0.0f;
+
+        float length_t = length(tangent);
+        triangle_tangents[t] = length_t > 0.0f ? tangent / length_t : vec3{ 0.0f };
+        triangle_keys[t] = face * 2 + (mirrored ? 1 : 0);
+    }
+}
+
+void TangentGenerator::splitSeams(vector<vec3>& positions, vector<vec3>& normals, vector<unsigned int>& indices, const vector<unsigned char>& triangle_keys) {
+    const unsigned int unused = ~0u;
+    size_t num_vertices = positions.size();
+    vector<unsigned int> copies(num_vertices * NUM_SEAM_KEYS, unused);
+    vector<unsigned char> first_key(num_vertices, NUM_SEAM_KEYS);
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        unsigned int v = indices[i];
+        unsigned char key = triangle_keys[i / 3];
+
+        // The first side keeps the original vertex
+        if (first_key[v] == NUM_SEAM_KEYS) {
+            first_key[v] = key;
+            copies[v * NUM_SEAM_KEYS + key] = v;
+        }
+
+        unsigned int& copy = copies[v * NUM_SEAM_KEYS + key];
+        if (copy == unused) {
+            copy = (unsigned int)positions.size();
+            positions.push_back(positions[v]);
+            normals.push_back(normals[v]);
+        }
+        indices[i] = copy;
+    }
+}
+
+void TangentGenerator::accumulate(const vector<vec3>& positions, const vector<vec3>& normals, const vector<unsigned int>& indices, const vector<vec3>& triangle_tangents, size_t first, size_t last,
+                                  vector<vec3>& sums) {
+    for (size_t t = first; t < last; t++) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            vec3 edge1 = positions[indices[t * 3 + (k + 1) % 3]] - positions[v];
+            vec3 edge2 = positions[indices[t * 3 + (k + 2) % 3]] - positions[v];
+            float length1 = length(edge1);
+            float length2 = length(edge2);
+            if (length1 == 0.0f || length2 == 0.0f) {
+                continue;
+            }
+
+            // Weighted by the corner angle, as in MikkTSpace
+            float angle = acos(clamp(dot(edge1, edge2) / (length1 * length2), -1.0f, 1.0f));
+            vec3 normal = normals[v];
+            vec3 tangent = triangle_tangents[t] - normal * dot(normal, triangle_tangents[t]);
+            float length_t = length(tangent);
+            if (length_t > 0.0f) {
+                sums[v] += tangent / length_t * angle;
+            }
+        }
+    }
+}
+
+vec3 TangentGenerator::orthogonalize(vec3 tangent, vec3 normal) {
+    // Gram-Schmidt
+    vec3 t = tangent - normal * dot(normal, tangent);
+    float length_t = length(t);
+    if (length_t > 1e-8f) {
+        return t / length_t;
+    }
+
+    // No UV gradient: any direction on the tangent plane
+    vec3 axis = abs(normal.x) < 0.9f ? vec3{ 1.0f, 0.0f, 0.0f } : vec3{ 0.0f, 1.0f, 0.0f };
+    return normalize(cross(normal, axis));
+}
+
+void TangentGenerator::parallelFor(size_t count, const function<void(size_t, size_t, int)>& task) {
+    int num_threads = numThreads(count);
+    if (num_threads == 1) {
+        task(0, count, 0);
+        return;
+    }
+
+    vector<future<void>> tasks;
+    size_t chunk = (count + num_threads - 1) / num_threads;
+    for (int i = 0; i < num_threads; i++) {
+        size_t first = std::min(count, i * chunk);
+        size_t last = std::min(count, first + chunk);
+        tasks.push_back(async(launch::async, task, first, last, i));
+    }
+    for (future<void>& f : tasks) {
+        f.get();
+    }
+}
+
+int TangentGenerator::numThreads(size_t count) {
+    int max_threads = std::max(1u, thread::hardware_concurrency());
+    return (int)std::max<size_t>(1, std::min<size_t>(max_threads, count / MIN_TRIANGLES_PER_THREAD));
+}
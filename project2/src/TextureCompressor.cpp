@@ -0,0 +1,322 @@
+#include "TextureCompressor.hpp"
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "PixelConverter.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+using namespace std;
+
+#define BLOCK_SIZE 4
+#define BLOCK_PIXELS 16
+#define BC1_BLOCK_BYTES 8
+#define BC4_BLOCK_BYTES 8
+
+const int cube_face_offsets[6][2] = {
+    { 2, 1 },   // Right face
+    { 0, 1 },   // Left face
+    { 1, 0 },   // Top face
+    { 1, 2 },   // Bottom face
+    { 1, 1 },   // Front face
+    { 3, 1 }    // Back face
+};
+
+bool TextureCompressor::loadCached(const string filename, bool is_cube, bool is_normal_map, KtxFile* ktx) {
+    string cache_file = cachePath(filename);
+    if (ktx->read(cache_file) && isCacheValid(filename, *ktx)) {
+        return true;
+    }
+
+    if (!encode(filename, is_cube, is_normal_map, ktx)) {
+        return false;
+    }
+    if (!ktx->write(cache_file)) {
+        cerr << "Unable to write texture cache " << cache_file << endl;
+    }
+    return true;
+}
+
+bool TextureCompressor::encode(const string filename, bool is_cube, bool is_normal_map, KtxFile* ktx) {
+    int im_width, im_height, n_channels;
+    unsigned char* im_data = stbi_load(filename.c_str(), &im_width, &im_height, &n_channels, 4);
+    if (!im_data) {
+        return false;
+    }
+    if (is_normal_map) {
+        // BC5 keeps only X and Y
+        PixelConverter::normalizeVectors(im_data, 4, (size_t)im_width * im_height);
+    }
+
+    int face_width = im_width;
+    int face_height = im_height;
+    ktx->num_faces = 1;
+    if (is_cube) {
+        if (im_height % 3 != 0 || im_width % 4 != 0) {
+            stbi_image_free(im_data);
+            return false;
+        }
+        face_width = im_width / 4;
+        face_height = im_height / 3;
+        ktx->num_faces = 6;
+    }
+
+    ktx->key_values[TEXTURE_ENCODER_KEY] = TEXTURE_ENCODER_VERSION;
+    ktx->internal_format = compressedFormat(is_normal_map);
+    ktx->base_internal_format = is_normal_map ? GL_RG : GL_RGB;
+    ktx->width = face_width;
+    ktx->height = face_height;
+    ktx->num_levels = numLevels(face_width, face_height);
+    ktx->images.assign(ktx->num_levels * ktx->num_faces, vector<unsigned char>());
+
+    for (int face = 0; face < ktx->num_faces; face++) {
+        // Copy the face out of the atlas
+        int face_x = is_cube ? cube_face_offsets[face][0] * face_width : 0;
+        int face_y = is_cube ? cube_face_offsets[face][1] * face_height : 0;
+        vector<unsigned char> level_data(face_width * face_height * 4);
+        for (int y = 0; y < face_height; y++) {
+            memcpy(&level_data[y * face_width * 4], im_data + ((face_y + y) * im_width + face_x) * 4, face_width * 4);
+        }
+
+        // Compress every mip level, filtered on the CPU from the previous one
+        int level_width = face_width;
+        int level_height = face_height;
+        for (int level = 0; level < ktx->num_levels; level++) {
+            compressImage(level_data.data(), level_width, level_height, is_normal_map, &ktx->images[level * ktx->num_faces + face]);
+
+            if (level + 1 < ktx->num_levels) {
+                level_data = downsample(level_data, level_width, level_height);
+                level_width = std::max(1, level_width / 2);
+                level_height = std::max(1, level_height / 2);
+            }
+        }
+    }
+
+    stbi_image_free(im_data);
+    return true;
+}
+
+string TextureCompressor::cachePath(const string filename) {
+    return filename + ".ktx";
+}
+
+int TextureCompressor::numLevels(int width, int height) {
+    return 1 + (int)floor(log2(std::max(width, height)));
+}
+
+size_t TextureCompressor::compressedSize(int width, int height, int num_faces, bool is_normal_map) {
+    size_t size = 0;
+    for (int level = 0; level < numLevels(width, height); level++) {
+        size += compressedImageSize(std::max(1, width >> level), std::max(1, height >> level), is_normal_map);
+    }
+    return size * num_faces;
+}
+
+unsigned int TextureCompressor::compressedFormat(bool is_normal_map) {
+    return is_normal_map ? GL_COMPRESSED_RG_RGTC2 : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+unsigned int TextureCompressor::compressedImageSize(int width, int height, bool is_normal_map) {
+    int blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return blocks_x * blocks_y * (is_normal_map ? 2 * BC4_BLOCK_BYTES : BC1_BLOCK_BYTES);
+}
+
+bool TextureCompressor::isCacheValid(const string filename, const KtxFile& ktx) {
+    auto version = ktx.key_values.find(TEXTURE_ENCODER_KEY);
+    if (version == ktx.key_values.end() || version->second != TEXTURE_ENCODER_VERSION) {
+        return false;
+    }
+
+    error_code error;
+    auto cache_time = filesystem::last_write_time(cachePath(filename), error);
+    if (error) {
+        return false;
+    }
+    auto source_time = filesystem::last_write_time(filename, error);
+    return error || cache_time >= source_time;
+}
+
+void TextureCompressor::compressImage(const unsigned char* rgba, int width, int height, bool is_normal_map, vector<unsigned char>* out) {
+    int blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int block_bytes = is_normal_map ? 2 * BC4_BLOCK_BYTES : BC1_BLOCK_BYTES;
+    out->resize(compressedImageSize(width, height, is_normal_map));
+
+    unsigned char block[BLOCK_PIXELS * 4];
+    unsigned char* dst = out->data();
+    for (int by = 0; by < blocks_y; by++) {
+        for (int bx = 0; bx < blocks_x; bx++) {
+            fetchBlock(rgba, width, height, bx * BLOCK_SIZE, by * BLOCK_SIZE, block);
+
+            if (is_normal_map) {
+                // BC5: a BC4 block for X (red) followed by one for Y (green)
+                compressBC4Block(block, 0, dst);
+                compressBC4Block(block, 1, dst + BC4_BLOCK_BYTES);
+            } else {
+                compressBC1Block(block, dst);
+            }
+            dst += block_bytes;
+        }
+    }
+}
+
+void TextureCompressor::fetchBlock(const unsigned char* rgba, int width, int height, int block_x, int block_y, unsigned char* block) {
+    // Blocks crossing the image border repeat the edge pixels
+    for (int y = 0; y < BLOCK_SIZE; y++) {
+        int src_y = std::min(block_y + y, height - 1);
+        for (int x = 0; x < BLOCK_SIZE; x++) {
+            int src_x = std::min(block_x + x, width - 1);
+            memcpy(block + (y * BLOCK_SIZE + x) * 4, rgba + (src_y * width + src_x) * 4, 4);
+        }
+    }
+}
+
+static unsigned short toRGB565(const int* color) {
+    int r = (color[0] * 31 + 127) / 255;
+    int g = (color[1] * 63 + 127) / 255;
+    int b = (color[2] * 31 + 127) / 255;
+    return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void fromRGB565(unsigned short c, int* color) {
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Based on: J.M.P. van Waveren, "Real-Time DXT Compression" (bounding box with inset)
+void TextureCompressor::compressBC1Block(const unsigned char* block, unsigned char* out) {
+    int min_color[3] = { 255, 255, 255 };
+    int max_color[3] = { 0, 0, 0 };
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        for (int c = 0; c < 3; c++) {
+            min_color[c] = std::min(min_color[c], (int)block[i * 4 + c]);
+            max_color[c] = std::max(max_color[c], (int)block[i * 4 + c]);
+        }
+    }
+
+    // Select the box diagonal that follows the colors' main direction
+    int center[3];
+    for (int c = 0; c < 3; c++) {
+        center[c] = (min_color[c] + max_color[c]) / 2;
+    }
+    int cov_rg = 0, cov_rb = 0;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        int dr = block[i * 4] - center[0];
+        cov_rg += dr * (block[i * 4 + 1] - center[1]);
+        cov_rb += dr * (block[i * 4 + 2] - center[2]);
+    }
+    if (cov_rg < 0) {
+        std::swap(min_color[1], max_color[1]);
+    }
+    if (cov_rb < 0) {
+        std::swap(min_color[2], max_color[2]);
+    }
+
+    // Inset the endpoints by 1/16 of the range to reduce the error of the end colors
+    for (int c = 0; c < 3; c++) {
+        int inset = (max_color[c] - min_color[c]) / 16;
+        max_color[c] -= inset;
+        min_color[c] += inset;
+    }
+
+    unsigned short color0 = toRGB565(max_color);
+    unsigned short color1 = toRGB565(min_color);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    // color0 > color1 selects the four color mode
+    int palette[4][3];
+    fromRGB565(color0, palette[0]);
+    fromRGB565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    unsigned int indices = 0;
+    if (color0 != color1) {
+        for (int i = 0; i < BLOCK_PIXELS; i++) {
+            int best_index = 0;
+            int best_dist = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dist = 0;
+                for (int c = 0; c < 3; c++) {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    dist += d * d;
+                }
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best_index = p;
+                }
+            }
+            indices |= best_index << (2 * i);
+        }
+    }
+
+    out[0] = color0 & 0xFF;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+void TextureCompressor::compressBC4Block(const unsigned char* block, int channel, unsigned char* out) {
+    int min_value = 255;
+    int max_value = 0;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        min_value = std::min(min_value, (int)block[i * 4 + channel]);
+        max_value = std::max(max_value, (int)block[i * 4 + channel]);
+    }
+
+    // value0 > value1 selects the 8 value mode: value0, value1 and 6 interpolated steps
+    unsigned long long indices = 0;
+    if (max_value > min_value) {
+        int range = max_value - min_value;
+        for (int i = 0; i < BLOCK_PIXELS; i++) {
+            int step = ((max_value - block[i * 4 + channel]) * 7 + range / 2) / range;
+            int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+            indices |= (unsigned long long)index << (3 * i);
+        }
+    }
+
+    out[0] = max_value;
+    out[1] = min_value;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+vector<unsigned char> TextureCompressor::downsample(const vector<unsigned char>& rgba, int width, int height) {
+    int out_width = std::max(1, width / 2);
+    int out_height = std::max(1, height / 2);
+    vector<unsigned char> out(out_width * out_height * 4);
+
+    // 2x2 box filter, odd edges clamp to the last row/column
+    for (int y = 0; y < out_height; y++) {
+        int y0 = std::min(2 * y, height - 1);
+        int y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < out_width; x++) {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = rgba[(y0 * width + x0) * 4 + c] + rgba[(y0 * width + x1) * 4 + c] +
+                          rgba[(y1 * width + x0) * 4 + c] + rgba[(y1 * width + x1) * 4 + c];
+                out[(y * out_width + x) * 4 + c] = (sum + 2) / 4;
+            }
+        }
+    }
+    return out;
+}
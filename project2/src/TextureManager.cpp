@@ -0,0 +1,102 @@
+#include "TextureManager.hpp"
+
+using namespace std;
+
+// Default GPU memory budget for textures
+#define DEFAULT_TEXTURE_BUDGET (256 * 1024 * 1024)
+
+TextureManager::TextureManager() {
+    budget_bytes = DEFAULT_TEXTURE_BUDGET;
+    resident_bytes = 0;
+
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+TextureManager::~TextureManager() {
+    for (Entry& entry : entries) {
+        delete entry.texture;
+    }
+}
+
+CubemapTexture* TextureManager::get(const string text_file, const string normal_map_file) {
+    string key = text_file + "|" + normal_map_file;
+
+    auto found = lookup.find(key);
+    if (found != lookup.end()) {
+        // Decoding failed after it was requested
+        if (found->second->texture->hasFailed()) {
+            return NULL;
+        }
+        hits++;
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->texture;
+    }
+
+    misses++;
+    bool is_flat = text_file.find("flat") != string::npos;
+    CubemapTexture* texture = new CubemapTexture(text_file, normal_map_file, is_flat);
+    texture->decode();   // Streams in from update()
+    if (texture->hasFailed()) {
+        delete texture;
+        return NULL;
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.texture = texture;
+    entry.byte_size = texture->getByteSize();
+    entries.push_front(entry);
+    lookup[key] = entries.begin();
+    resident_bytes += entry.byte_size;
+
+    enforceBudget();
+    return texture;
+}
+
+void TextureManager::update() {
+    bool resized = false;
+    for (Entry& entry : entries) {
+        entry.texture->update();
+
+        // Charged at decode, changes when the .ktx cache falls back to uncompressed or the texture fails
+        size_t byte_size = entry.texture->getByteSize();
+        if (byte_size != entry.byte_size) {
+            resident_bytes = resident_bytes - entry.byte_size + byte_size;
+            entry.byte_size = byte_size;
+            resized = true;
+        }
+    }
+    if (resized) {
+        enforceBudget();
+    }
+}
+
+void TextureManager::setBudget(size_t budget_bytes) {
+    this->budget_bytes = budget_bytes;
+    enforceBudget();
+}
+
+size_t TextureManager::getResidentBytes() const {
+    return resident_bytes;
+}
+
+void TextureManager::printStats() const {
+    cout << "Textures: " << entries.size() << " resident, " << resident_bytes / (1024 * 1024) << " / " << budget_bytes / (1024 * 1024) << " MB, "
+         << hits << " hits, " << misses << " misses, " << evictions << " evictions" << endl;
+}
+
+void TextureManager::enforceBudget() {
+    // The most recently used texture is the one on screen, never evict it
+    while (resident_bytes > budget_bytes && entries.size() > 1) {
+        Entry& lru = entries.back();
+        cout << "Evicting texture (" << lru.byte_size / 1024 << " KB): " << lru.key << endl;
+
+        resident_bytes -= lru.byte_size;
+        lookup.erase(lru.key);
+        delete lru.texture;
+        entries.pop_back();
+        evictions++;
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * Offline texture compressor.
+ *
+ * Writes the .ktx cache beside each image, the same file the viewer creates on first load.
+ * Textures under a "flat" directory are encoded as 2D, others as 4x3 cubemap atlases,
+ * and "*_normal" images as two-channel normal maps.
+ *
+ * Usage: ./ktx_encode image.ext [image2.ext ...]
+ */
+
+#include <iostream>
+
+#include "TextureCompressor.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: ./ktx_encode image.ext [image2.ext ...]" << endl;
+        exit(-1);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        string filename = argv[i];
+        bool is_cube = filename.find("flat") == string::npos;
+        bool is_normal_map = filename.find("_normal") != string::npos;
+
+        KtxFile ktx;
+        if (!TextureCompressor::encode(filename, is_cube, is_normal_map, &ktx)) {
+            cerr << "Failed to encode " << filename << endl;
+            continue;
+        }
+
+        string cache_file = TextureCompressor::cachePath(filename);
+        if (ktx.write(cache_file)) {
+            cout << cache_file << ": " << ktx.width << "x" << ktx.height << ", " << ktx.num_faces << " face(s), "
+                 << ktx.num_levels << " levels, " << ktx.getByteSize() << " bytes" << endl;
+        } else {
+            cerr << "Failed to write " << cache_file << endl;
+        }
+    }
+}